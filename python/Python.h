@@ -12,10 +12,12 @@
 #include <boost/python.hpp>
 #include <boost/python/suite/indexing/vector_indexing_suite.hpp>
 #include <boost/python/suite/indexing/map_indexing_suite.hpp>
+#include <boost/python/numpy.hpp>
 
 
 using namespace Aboria;
 using namespace boost::python;
+namespace np = boost::python::numpy;
 
 
 
@@ -96,6 +98,95 @@ void setitem_Vect3d(Vect3d& v, int index, float val)
 }
 
 
+template <typename T>
+struct numpy_element {
+    typedef T type;
+    static const unsigned int size = 1;
+};
+
+template <typename T, unsigned int N>
+struct numpy_element<Vector<T,N> > {
+    typedef T type;
+    static const unsigned int size = N;
+};
+
+//
+// Returns a NumPy array that shares memory with variable T of the 
+// particle container held by the python object self (which is kept alive 
+// by the array). Scalar variables give a 1D array, Vector variables give 
+// a (n,N) array. See array_docstring for when the array becomes invalid
+//
+template<typename T, typename ParticlesType>
+np::ndarray get_array(object self) {
+    typedef typename T::value_type value_type;
+    typedef typename numpy_element<value_type>::type element_type;
+    const unsigned int N = numpy_element<value_type>::size;
+
+    ParticlesType& particles = extract<ParticlesType&>(self);
+    element_type* data = reinterpret_cast<element_type*>(
+                            get<T>(particles).data());
+    const Py_intptr_t n = particles.size();
+    if (N == 1) {
+        return np::from_data(data,np::dtype::get_builtin<element_type>(),
+                boost::python::make_tuple(n),
+                boost::python::make_tuple(sizeof(value_type)),
+                self);
+    } else {
+        return np::from_data(data,np::dtype::get_builtin<element_type>(),
+                boost::python::make_tuple(n,N),
+                boost::python::make_tuple(sizeof(value_type),sizeof(element_type)),
+                self);
+    }
+}
+
+const char* array_docstring = 
+    "Return a NumPy array that shares memory with this variable, without "
+    "copying it. Writes to the array change the particles. The array is "
+    "only valid until the particles are next added, removed or reordered "
+    "(e.g. by resizing or moving them), or until the variable is next "
+    "assigned by a symbolic expression, which can swap in new storage. "
+    "Fetch the array again after any of these.";
+
+//
+// Returns the neighbours within radius of every particle as a tuple of
+// NumPy arrays (indptr, indices, distances), see neighbours_csr()
+//
+template<typename ParticlesType>
+boost::python::tuple get_neighbours_csr(const ParticlesType& particles, const double radius) {
+    if ((particles.get_lengthscale() < radius).any()) {
+        PyErr_SetString(PyExc_ValueError, "radius is larger than the search length scale");
+        throw boost::python::error_already_set();
+    }
+    std::vector<int64_t> indptr,indices;
+    std::vector<double> distances;
+    neighbours_csr(particles,radius,indptr,indices,distances);
+
+    np::ndarray indptr_array = np::empty(boost::python::make_tuple(indptr.size()),
+                                         np::dtype::get_builtin<int64_t>());
+    np::ndarray indices_array = np::empty(boost::python::make_tuple(indices.size()),
+                                          np::dtype::get_builtin<int64_t>());
+    np::ndarray distances_array = np::empty(boost::python::make_tuple(distances.size()),
+                                            np::dtype::get_builtin<double>());
+    std::copy(indptr.begin(),indptr.end(),
+              reinterpret_cast<int64_t*>(indptr_array.get_data()));
+    std::copy(indices.begin(),indices.end(),
+              reinterpret_cast<int64_t*>(indices_array.get_data()));
+    std::copy(distances.begin(),distances.end(),
+              reinterpret_cast<double*>(distances_array.get_data()));
+    return boost::python::make_tuple(indptr_array,indices_array,distances_array);
+}
+
+const char* neighbours_csr_docstring = 
+    "neighbours_csr(radius) -> (indptr, indices, distances)\n\n"
+    "Find the neighbours within radius of every particle, in compressed "
+    "sparse row form. The neighbours of particle i are "
+    "indices[indptr[i]:indptr[i+1]], at distances[indptr[i]:indptr[i+1]]. "
+    "Particles are not their own neighbours, and radius must not be larger "
+    "than the length scale of the neighbourhood search. The arrays are "
+    "copies, but the indices refer to the current order of the particles, "
+    "which changes when they are added, removed or moved.";
+
+
 template<class T>
 struct vtkSmartPointer_to_python {
 	static PyObject *convert(const vtkSmartPointer<T> &p) {
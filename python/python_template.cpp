@@ -17,6 +17,8 @@ typedef Particles<variable_tuple> particles_type;
 
 BOOST_PYTHON_MODULE(/*{{particles.name}}*/) {
 
+	np::initialize();
+
 	VTK_PYTHON_CONVERSION(vtkUnstructuredGrid);
 
 	Vect3_from_python_list<double>();
@@ -31,7 +33,11 @@ BOOST_PYTHON_MODULE(/*{{particles.name}}*/) {
 	    .def(boost::python::vector_indexing_suite<particles_type>())
         /*{% for variable in variables %}*/
         .def("get_/*{{variable.type_name}}*/",&particles_type::get</*{{variable.type_name}}*/>)
+        .def("/*{{variable.type_name}}*/_array",&get_array</*{{variable.type_name}}*/,particles_type>,array_docstring)
         /*{% endfor %}*/
+        .def("position_array",&get_array<particles_type::position,particles_type>,array_docstring)
+        .def("id_array",&get_array<id,particles_type>,array_docstring)
+        .def("neighbours_csr",&get_neighbours_csr<particles_type>,neighbours_csr_docstring)
         .def("set",&particles_type::set)
 	    ;
 
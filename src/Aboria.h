@@ -51,6 +51,10 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Evaluate.h"
 //TODO: seems clumsy here
 #include "detail/SymbolicAssignment.h"
+#include "Integrators.h"
+#include "Profile.h"
+
+#include "Instantiate.h"
 
 
 #endif /* ABORIA_H_ */
@@ -0,0 +1,175 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+#ifndef ASYNC_WRITER_H_
+#define ASYNC_WRITER_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Log.h"
+
+namespace Aboria {
+
+/// writes snapshots of a particle container in a background thread, so 
+/// that output does not block the simulation.
+///
+/// Each call to write() copies the container into one of \p max_pending 
+/// staging containers (which are reused, so after the first few calls this
+/// is a copy of each column into existing storage) and queues it. A 
+/// single background thread then calls the user-supplied write function
+/// for each queued snapshot, in order. If all the staging containers are 
+/// waiting to be written then write() blocks until one is free, so a slow
+/// file system slows down the simulation rather than exhausting memory.
+///
+/// \code
+/// async_writer<MyParticles> writer(
+///         [](const MyParticles& p, const std::string& filename) {
+///             write_vtu(p,filename);
+///         });
+/// for (int i=0; i<nout; ++i) {
+///     // ... timesteps ...
+///     writer.write(particles,"sph"+std::to_string(i)+".vtu");
+/// }
+/// writer.wait();
+/// \endcode
+template <typename ParticlesType>
+class async_writer {
+public:
+    typedef std::function<void(const ParticlesType&, const std::string&)> write_function_type;
+
+    /// start the background thread, which will call \p write_function for 
+    /// each snapshot. At most \p max_pending snapshots are held in memory
+    async_writer(write_function_type write_function, const size_t max_pending = 2):
+        m_write_function(write_function),
+        m_stop(false)
+    {
+        CHECK(max_pending > 0,"async_writer needs at least one staging buffer");
+        for (size_t i=0; i<max_pending; ++i) {
+            m_buffers.emplace_back(new snapshot());
+            m_free.push_back(m_buffers.back().get());
+        }
+        m_thread = std::thread(&async_writer::run,this);
+    }
+
+    async_writer(const async_writer&) = delete;
+    async_writer& operator=(const async_writer&) = delete;
+
+    /// write all pending snapshots and stop the background thread
+    ~async_writer() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+
+    /// queue a snapshot of \p particles to be written to \p filename. 
+    /// \p particles can be modified as soon as this function returns
+    void write(const ParticlesType& particles, const std::string& filename) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock,[this]{ return !m_free.empty(); });
+        snapshot* s = m_free.back();
+        m_free.pop_back();
+        lock.unlock();
+
+        s->particles = particles;
+        s->filename = filename;
+
+        lock.lock();
+        m_pending.push_back(s);
+        lock.unlock();
+        m_condition.notify_all();
+    }
+
+    /// block until all queued snapshots have been written
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock,[this]{ return m_pending.empty(); });
+    }
+
+    /// the number of snapshots queued or being written
+    size_t pending() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pending.size();
+    }
+
+private:
+    struct snapshot {
+        ParticlesType particles;
+        std::string filename;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_condition.wait(lock,[this]{ return m_stop || !m_pending.empty(); });
+            if (m_pending.empty()) return;
+
+            // leave the snapshot in the queue while it is written so that 
+            // wait() also waits for it
+            snapshot* s = m_pending.front();
+            lock.unlock();
+            LOG(2,"async_writer: writing "<<s->filename);
+            m_write_function(s->particles,s->filename);
+            lock.lock();
+            m_pending.pop_front();
+            m_free.push_back(s);
+            m_condition.notify_all();
+        }
+    }
+
+    write_function_type m_write_function;
+    std::vector<std::unique_ptr<snapshot>> m_buffers;
+    std::vector<snapshot*> m_free;
+    std::deque<snapshot*> m_pending;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_thread;
+};
+
+}
+
+#endif /* ASYNC_WRITER_H_ */
@@ -78,7 +78,7 @@ class bucket_search_parallel:
 
     typedef typename Traits::double_d double_d;
     typedef typename Traits::position position;
-    typedef typename Traits::vector_double_d_const_iterator vector_double_d_const_iterator;
+    typedef typename Traits::position_vector_type::const_iterator vector_position_const_iterator;
     typedef typename Traits::vector_unsigned_int_iterator vector_unsigned_int_iterator;
     typedef typename Traits::vector_unsigned_int vector_unsigned_int;
     typedef typename Traits::unsigned_int_d unsigned_int_d;
@@ -229,8 +229,8 @@ private:
     }
 
     void build_bucket_indices(
-        vector_double_d_const_iterator positions_begin,
-        vector_double_d_const_iterator positions_end,
+        vector_position_const_iterator positions_begin,
+        vector_position_const_iterator positions_end,
         vector_unsigned_int_iterator bucket_indices_begin) {
         // transform the points to their bucket indices
         detail::transform(positions_begin,
@@ -38,15 +38,67 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef EVALUATE_H_
 #define EVALUATE_H_
 
+#include <array>
+#include <algorithm>
+
 #include "Symbolic.h"
+#include "ParticlesView.h"
+#include "Profile.h"
 #include "detail/Evaluate.h"
 
 namespace Aboria {
 
+namespace detail {
+
+// evaluates \p expr for each particle and stores the result, combined with
+// the current value using \p Functor, in \p buffer
+template<typename VariableType, typename Functor, typename ExprRHS, typename ParticlesType>
+void evaluate_into_buffer(ExprRHS const & expr, ParticlesType& particles, 
+        std::vector<typename VariableType::value_type>& buffer, std::false_type) {
+    const size_t n = particles.size();
+    Functor functor;
+    #pragma omp parallel for
+    for (size_t i=0; i<n; i++) {
+        buffer[i] = functor(get<VariableType>(particles[i]),eval(expr,particles[i]));
+    }
+}
+
+// as above, but reads the variables directly from the columns of 
+// \p particles, in packs of particles that the compiler can vectorise
+template<typename VariableType, typename Functor, typename ExprRHS, typename ParticlesType>
+void evaluate_into_buffer(ExprRHS const & expr, ParticlesType& particles, 
+        std::vector<typename VariableType::value_type>& buffer, std::true_type) {
+    typedef ColumnEvalCtx<ParticlesType> ctx_type;
+    const size_t pack_size = 8;
+    const ParticlesType& const_particles = particles;
+    const std::vector<typename VariableType::value_type>& column = 
+        get<VariableType>(const_particles);
+    const size_t n = particles.size();
+    Functor functor;
+    #pragma omp parallel for
+    for (size_t pack=0; pack<n; pack+=pack_size) {
+        const size_t end = std::min(pack+pack_size,n);
+        #pragma omp simd
+        for (size_t i=pack; i<end; i++) {
+            ctx_type const ctx(const_particles,i);
+            buffer[i] = functor(column[i],proto::eval(expr,ctx));
+        }
+    }
+}
+
+}
 
 /// Evaluates a non-linear operator \p expr over a set of particles 
 /// given by label \p label and stores the result, using the functor
-/// \p Functor, in variable with type \p VariableType
+/// \p Functor, in variable with type \p VariableType. 
+///
+/// If \p expr reads \p VariableType through another label (e.g. 
+/// `s[a] = sum(b,norm(dx)<r,s[b])`) the result is evaluated into a buffer
+/// that is then swapped with the column of \p VariableType (see 
+/// Particles::swap_variable). After such an assignment, pointers taken 
+/// earlier from `get<VariableType>(particles).data()`, get_grid_view() or 
+/// the NumPy arrays of the python bindings refer to stale storage and must
+/// be taken again
 template<typename VariableType, typename Functor, typename ExprRHS, typename LabelType>
 void evaluate_nonlinear(ExprRHS const & expr, LabelType &label) {
     typedef typename VariableType::value_type value_type;
@@ -56,44 +108,603 @@ void evaluate_nonlinear(ExprRHS const & expr, LabelType &label) {
     typedef typename proto::matches<ExprRHS, detail::is_not_aliased<VariableType,LabelType>>  not_aliased;
     typedef typename LabelType::particles_type particles_type;
 
+    ABORIA_PROFILE_ONLY(detail::profile_statement<VariableType> profile;)
+
     particles_type& particles = label.get_particles();
 
     // check expr is a univariate expression and that it refers to the same particles container
     check_valid_assign_expr(label,expr);
     
-    // if aliased then need to copy to a tempory buffer first 
-    std::vector<value_type>& buffer =
-        (not_aliased::value) ?
-        get<VariableType>(particles)
-        : get<VariableType>(label.get_buffers());
-    buffer.resize(particles.size());
+    // if aliased, or if the label refers to a ParticlesView, then need to 
+    // copy to a tempory buffer first 
+    typedef std::integral_constant<bool,
+                not_aliased::value && !is_particles_view<particles_type>::value> 
+                    in_place;
+    std::vector<value_type>& buffer = 
+        detail::get_evaluate_buffer<VariableType>(particles,label,in_place());
+    detail::resize_evaluate_buffer(buffer,particles.size());
+
+
+    // evaluate expression for all particles and store in buffer. Expressions
+    // that only use the particles' own variables are evaluated directly
+    // from the columns of the container
+    typedef std::integral_constant<bool,
+                proto::matches<ExprRHS, detail::is_column_expr>::value 
+                && !is_particles_view<particles_type>::value> 
+                    column_eval;
+    detail::evaluate_into_buffer<VariableType,Functor>(expr,particles,buffer,column_eval());
+
+    //if not evaluated in-place then copy back from the buffer
+    if (in_place::value == false) {
+        detail::copy_back_evaluate_buffer<VariableType>(particles,buffer,
+                is_particles_view<particles_type>());
+    }
+    particles.template mark_dirty<VariableType>();
 
+    if (boost::is_same<VariableType,position>::value) {
+        particles.update_positions();
+    }
+
+    if (boost::is_same<VariableType,alive>::value) {
+        particles.delete_particles();
+    }
 
-    // evaluate expression for all particles and store in buffer
+}
+
+namespace detail {
+
+// a fused statement is written in-place unless its variable is read through
+// another label by any statement in the group (or the label is a view)
+template <typename Statement, typename... Statements>
+struct fused_in_place:
+    std::integral_constant<bool,
+        is_not_aliased_in_any<typename Statement::variable_type,
+                              typename Statement::label_type,
+                              Statements...>::value
+        && !is_particles_view<
+                typename Statement::label_type::particles_type>::value>
+{};
+
+template <typename... Statements>
+void check_fused_statements(std::tuple<>*, std::tuple<Statements...>*) {}
+
+template <typename Statement, typename... Rest, typename... Statements>
+void check_fused_statements(std::tuple<Statement,Rest...>*,
+                            std::tuple<Statements...>*) {
+    typedef typename Statement::variable_type variable_type;
+    typedef typename Statement::label_type label_type;
+    typedef typename label_type::particles_type particles_type;
+    typedef typename particles_type::position position;
+    typedef typename std::tuple_element<0,std::tuple<Statements...>>::type first_statement;
+
+    static_assert(boost::is_same<label_type,typename first_statement::label_type>::value,
+            "all statements in a fused group must use the same label");
+    static_assert(fused_in_place<Statement,Statements...>::value ||
+                  is_not_used_in_any<variable_type,label_type,Rest...>::value,
+            "a variable that is read through another label cannot be used by later statements in the same fused group");
+    static_assert(!(boost::is_same<variable_type,position>::value ||
+                    boost::is_same<variable_type,alive>::value) ||
+                  is_local_in_all<Rest...>::value,
+            "statements after an update to position or alive cannot use the neighbour search in the same fused group");
+
+    check_fused_statements(static_cast<std::tuple<Rest...>*>(nullptr),
+                           static_cast<std::tuple<Statements...>*>(nullptr));
+}
+
+template <typename Statement, typename ParticlesType>
+void evaluate_fused_statement(const size_t i, ParticlesType& particles,
+        std::vector<typename Statement::variable_type::value_type>& buffer,
+        const Statement& statement, std::false_type) {
+    typedef typename Statement::variable_type variable_type;
+    typename Statement::functor_type functor;
+    buffer[i] = functor(get<variable_type>(particles[i]),eval(statement.expr,particles[i]));
+}
+
+template <typename Statement, typename ParticlesType>
+void evaluate_fused_statement(const size_t i, ParticlesType& particles,
+        std::vector<typename Statement::variable_type::value_type>& buffer,
+        const Statement& statement, std::true_type) {
+    typedef typename Statement::variable_type variable_type;
+    typedef ColumnEvalCtx<ParticlesType> ctx_type;
+    const ParticlesType& const_particles = particles;
+    typename Statement::functor_type functor;
+    ctx_type const ctx(const_particles,i);
+    buffer[i] = functor(get<variable_type>(const_particles)[i],proto::eval(statement.expr,ctx));
+}
+
+template <typename Statement, typename ParticlesType>
+void evaluate_fused_statement(const size_t i, ParticlesType& particles,
+        std::vector<typename Statement::variable_type::value_type>& buffer,
+        const Statement& statement) {
+    typedef std::integral_constant<bool,
+                proto::matches<typename Statement::expr_type, is_column_expr>::value 
+                && !is_particles_view<ParticlesType>::value> 
+                    column_eval;
+    evaluate_fused_statement(i,particles,buffer,statement,column_eval());
+}
+
+template <typename Statement, typename ParticlesType>
+void copy_back_fused_statement(ParticlesType& particles,
+        std::vector<typename Statement::variable_type::value_type>& buffer,
+        std::false_type) {
+    copy_back_evaluate_buffer<typename Statement::variable_type>(particles,buffer,
+            is_particles_view<ParticlesType>());
+}
+
+template <typename Statement, typename ParticlesType>
+void copy_back_fused_statement(ParticlesType&,
+        std::vector<typename Statement::variable_type::value_type>&,
+        std::true_type) {}
+
+// copy back buffers, mark variables as changed and update the search, at
+// most once, for the statements in a group that are marked \p active
+template <typename ParticlesType, typename BuffersType, typename InPlaceType,
+          size_t... I, typename... Statements>
+void finish_fused_statements(ParticlesType& particles, BuffersType& buffers,
+        const InPlaceType& in_place, index_sequence<I...>, std::tuple<Statements...>*,
+        const std::array<bool,sizeof...(Statements)>& active) {
+    typedef typename ParticlesType::position position;
+
+    // copy back the statements that were not evaluated in-place
+    int copy_back[] = {0, (active[I] ? 
+                copy_back_fused_statement<Statements>(particles,*std::get<I>(buffers),
+                    std::get<I>(in_place)) : void(),0)...};
+    (void)copy_back;
+    int mark_dirty[] = {0, (active[I] ? 
+                particles.template mark_dirty<typename Statements::variable_type>() : void(),0)...};
+    (void)mark_dirty;
+
+    const bool is_position[] = {boost::is_same<typename Statements::variable_type,position>::value...};
+    const bool is_alive[] = {boost::is_same<typename Statements::variable_type,alive>::value...};
+    bool any_position = false;
+    bool any_alive = false;
+    for (size_t i=0; i<sizeof...(Statements); ++i) {
+        any_position |= active[i] && is_position[i];
+        any_alive |= active[i] && is_alive[i];
+    }
+    if (any_position) {
+        particles.update_positions();
+    }
+    if (any_alive) {
+        particles.delete_particles();
+    }
+}
+
+// copy back buffers, mark variables as changed and update the search, at
+// most once, for a group of statements
+template <typename ParticlesType, typename BuffersType, typename InPlaceType,
+          size_t... I, typename... Statements>
+void finish_fused_statements(ParticlesType& particles, BuffersType& buffers,
+        const InPlaceType& in_place, index_sequence<I...> index, 
+        std::tuple<Statements...>* statements) {
+    std::array<bool,sizeof...(Statements)> active;
+    active.fill(true);
+    finish_fused_statements(particles,buffers,in_place,index,statements,active);
+}
+
+template <typename ParticlesType, typename BuffersType, size_t... I, typename... Statements>
+void evaluate_fused_impl(ParticlesType& particles, BuffersType& buffers,
+        index_sequence<I...> index, Statements const&... statements) {
+    int resize[] = {0, (resize_evaluate_buffer(*std::get<I>(buffers),particles.size()),0)...};
+    (void)resize;
+
+    // evaluate all the statements for each particle in turn
+    const size_t n = particles.size();
+    #pragma omp parallel for
+    for (size_t i=0; i<n; i++) {
+        int evaluate[] = {0, (evaluate_fused_statement(i,particles,*std::get<I>(buffers),statements),0)...};
+        (void)evaluate;
+    }
+
+    finish_fused_statements(particles,buffers,
+            std::tuple<typename fused_in_place<Statements,Statements...>::type...>(),
+            index,static_cast<std::tuple<Statements...>*>(nullptr));
+}
+
+}
+
+/// Evaluates a group of deferred symbolic assignments in a single pass over
+/// the particles. Each statement is created using the assign, plus_assign,
+/// minus_assign, multiplies_assign or divides_assign members of a
+/// subscripted symbol, e.g.
+///
+/// evaluate_fused(v[a].plus_assign(dt*f[a]), p[a].plus_assign(dt*v[a]));
+///
+/// gives the same result as the statements `v[a] += dt*f[a]; p[a] += dt*v[a];`
+/// but loops over the particles once and updates the neighbour search at most
+/// once. Groups that cannot be evaluated in one pass, for example if a later
+/// statement reads a neighbour's value of a variable written by an earlier
+/// statement, are rejected at compile time. The statements are evaluated
+/// within the full expression in which they are created.
+template<typename Statement, typename... Statements>
+void evaluate_fused(Statement const & statement, Statements const&... statements) {
+    typedef typename Statement::label_type label_type;
+    typedef typename label_type::particles_type particles_type;
+
+    detail::check_fused_statements(
+            static_cast<std::tuple<Statement,Statements...>*>(nullptr),
+            static_cast<std::tuple<Statement,Statements...>*>(nullptr));
+
+    ABORIA_PROFILE_ONLY(detail::profile_statement<typename Statement::variable_type,
+            typename Statements::variable_type...> profile;)
+
+    particles_type& particles = statement.label.get_particles();
+    check_valid_assign_expr(statement.label,statement.expr);
+    int check[] = {0, (check_valid_assign_expr(statements.label,statements.expr),0)...};
+    (void)check;
+    for (particles_type* p: {&particles,&statements.label.get_particles()...}) {
+        CHECK(p == &particles,
+            "statements in a fused group do not refer to the same particles container");
+    }
+
+    // if aliased, or if the label refers to a ParticlesView, then each
+    // statement writes to a tempory buffer first
+    std::tuple<std::vector<typename Statement::variable_type::value_type>*,
+               std::vector<typename Statements::variable_type::value_type>*...>
+        buffers(&detail::get_evaluate_buffer<typename Statement::variable_type>(
+                        particles,statement.label,
+                        typename detail::fused_in_place<Statement,Statement,Statements...>::type()),
+                &detail::get_evaluate_buffer<typename Statements::variable_type>(
+                        particles,statements.label,
+                        typename detail::fused_in_place<Statements,Statement,Statements...>::type())...);
+
+    detail::evaluate_fused_impl(particles,buffers,
+            detail::make_index_sequence<1+sizeof...(Statements)>(),
+            statement,statements...);
+}
+
+namespace detail {
+
+// a neighbour sum is written in-place unless its variable is read through
+// another label by any of the sums or by the condition
+template <typename IfExpr, typename Statement, typename... Statements>
+struct sums_in_place:
+    std::integral_constant<bool,
+        fused_in_place<Statement,Statements...>::value
+        && proto::matches<IfExpr,
+                is_not_aliased<typename Statement::variable_type,
+                               typename Statement::label_type>>::value>
+{};
+
+template <typename IfExpr, typename LabelType>
+void check_sum_statements(std::tuple<>*) {}
+
+template <typename IfExpr, typename LabelType, typename Statement, typename... Rest>
+void check_sum_statements(std::tuple<Statement,Rest...>*) {
+    typedef typename Statement::variable_type variable_type;
+    typedef typename Statement::label_type label_type;
+
+    static_assert(boost::is_same<label_type,LabelType>::value,
+            "all statements in a group of neighbour sums must use the same label");
+    static_assert(is_not_used_in_any<variable_type,label_type,Rest...>::value,
+            "a variable written by a neighbour sum cannot be used by later sums in the same group");
+    static_assert(sizeof...(Rest) == 0 ||
+                  proto::matches<IfExpr,does_not_read<variable_type,label_type>>::value,
+            "a variable written by a neighbour sum cannot be used by the condition of later sums in the same group");
+
+    check_sum_statements<IfExpr,LabelType>(static_cast<std::tuple<Rest...>*>(nullptr));
+}
+
+// evaluate the condition and the sums for one pair of particles, sharing a
+// single evaluation context so that norm(dx) is only calculated once. 
+// Returns the value of the condition
+template <typename SumsType, typename IfExpr, typename LabelTypeB, typename DoubleD,
+          typename ReferenceA, typename ReferenceB, 
+          size_t... I, typename... Statements>
+bool accumulate_sums(SumsType& sums, IfExpr const& if_expr, const LabelTypeB&,
+        const DoubleD& dx, const ReferenceA& ai, const ReferenceB& bj,
+        index_sequence<I...>, Statements const&... statements) {
+    typedef typename std::tuple_element<0,std::tuple<Statements...>>::type::label_type 
+        label_a_type;
+    typedef fusion::map<fusion::pair<label_a_type,ReferenceA>,
+                        fusion::pair<LabelTypeB,ReferenceB>> map_type;
+    typedef fusion::list<const DoubleD&> list_type;
+
+    EvalCtx<map_type,list_type> const ctx(
+            fusion::make_map<label_a_type,LabelTypeB>(ai,bj),
+            fusion::make_list(boost::cref(dx)));
+    if (proto::eval(if_expr,ctx)) {
+        int accumulate[] = {0, (std::get<I>(sums) += proto::eval(statements.expr,ctx),0)...};
+        (void)accumulate;
+        return true;
+    }
+    return false;
+}
+
+// range condition, use the neighbour search
+template <typename SumsType, typename IfExpr, typename LabelTypeB,
+          typename ReferenceA, size_t... I, typename... Statements>
+void accumulate_sums(SumsType& sums, IfExpr const& if_expr, 
+        const LabelTypeB& label_b, const ReferenceA& ai, std::true_type,
+        index_sequence<I...> index, Statements const&... statements) {
+    typedef typename LabelTypeB::particles_type particles_b_type;
+    typedef typename particles_b_type::position position;
+    const particles_b_type& particlesb = label_b.get_particles();
+    ABORIA_PROFILE_ONLY(size_t candidates = 0; size_t accepted = 0;)
+    for (const auto& pairj: box_search(particlesb.get_query(),get<position>(ai))) {
+        const bool found = accumulate_sums(sums,if_expr,label_b,std::get<1>(pairj),
+                                           ai,std::get<0>(pairj),index,statements...);
+        ABORIA_PROFILE_ONLY(++candidates; accepted += found;)
+        (void)found;
+    }
+    ABORIA_PROFILE_ONLY(profile_pairs(candidates,accepted,accepted*sizeof...(I));)
+}
+
+// other conditions, loop over all the particles
+template <typename SumsType, typename IfExpr, typename LabelTypeB,
+          typename ReferenceA, size_t... I, typename... Statements>
+void accumulate_sums(SumsType& sums, IfExpr const& if_expr, 
+        const LabelTypeB& label_b, const ReferenceA& ai, std::false_type,
+        index_sequence<I...> index, Statements const&... statements) {
+    typedef typename LabelTypeB::particles_type particles_b_type;
+    typedef typename particles_b_type::position position;
+    typedef typename particles_b_type::double_d double_d;
+    const particles_b_type& particlesb = label_b.get_particles();
+    ASSERT(!particlesb.get_periodic().any(),"periodic does not work with dense");
+    const size_t nb = particlesb.size();
+    ABORIA_PROFILE_ONLY(size_t accepted = 0;)
+    for (size_t j=0; j<nb; ++j) {
+        typename particles_b_type::const_reference bj = particlesb[j];
+        const double_d dx = double_d(get<position>(bj))-double_d(get<position>(ai));
+        const bool found = accumulate_sums(sums,if_expr,label_b,dx,ai,bj,index,statements...);
+        ABORIA_PROFILE_ONLY(accepted += found;)
+        (void)found;
+    }
+    ABORIA_PROFILE_ONLY(profile_pairs(nb,accepted,accepted*sizeof...(I));)
+}
+
+template <typename ParticlesType, typename LabelTypeB, typename IfExpr, 
+          typename BuffersType, size_t... I, typename... Statements>
+void evaluate_sums_impl(ParticlesType& particles, const LabelTypeB& label_b,
+        IfExpr const& if_expr, BuffersType& buffers,
+        index_sequence<I...> index, Statements const&... statements) {
+    typedef std::integral_constant<bool,
+                proto::matches<IfExpr,range_if_expr>::value> is_range;
+
+    int resize[] = {0, (resize_evaluate_buffer(*std::get<I>(buffers),particles.size()),0)...};
+    (void)resize;
+
+    // traverse the neighbours of each particle once, filling all the sums
+    const ParticlesType& const_particles = particles;
     const size_t n = particles.size();
-    Functor functor;
     #pragma omp parallel for
     for (size_t i=0; i<n; i++) {
-        buffer[i] = functor(get<VariableType>(particles)[i],eval(expr,particles[i]));
+        typename ParticlesType::const_reference ai = const_particles[i];
+        std::tuple<typename Statements::variable_type::value_type...> 
+            sums(typename Statements::variable_type::value_type(0)...);
+        accumulate_sums(sums,if_expr,label_b,ai,is_range(),index,statements...);
+        int assign[] = {0, ((*std::get<I>(buffers))[i] = 
+                typename Statements::functor_type()(
+                    get<typename Statements::variable_type>(ai),std::get<I>(sums)),0)...};
+        (void)assign;
     }
 
-    //if aliased then copy back from the buffer
-    if (not_aliased::value == false) {
+    finish_fused_statements(particles,buffers,
+            std::tuple<typename sums_in_place<IfExpr,Statements,Statements...>::type...>(),
+            index,static_cast<std::tuple<Statements...>*>(nullptr));
+}
+
+}
+
+/// Evaluates several neighbour sums over label \p b that share the condition
+/// \p if_expr, using a single traversal of the neighbours of each particle.
+/// The right hand side of each statement is the term that is summed over the
+/// pairs of particles, and the sum is stored using the statement's assignment
+/// operator, e.g.
+///
+/// evaluate_sums(b, norm(dx)<2*h[a],
+///               s1[a].assign(W(norm(dx),h[a])),
+///               s2[a].plus_assign(m[b]*F(norm(dx),h[a])*dx));
+///
+/// gives the same result as the statements 
+/// `s1[a] = sum(b,norm(dx)<2*h[a],W(norm(dx),h[a]));`
+/// and `s2[a] += sum_vect(b,norm(dx)<2*h[a],m[b]*F(norm(dx),h[a])*dx);`, but 
+/// searches for neighbours and evaluates the condition once. A variable 
+/// written by one of the sums cannot be used by the later sums in the group.
+template<typename LabelB, typename IfExpr, typename Statement, typename... Statements>
+void evaluate_sums(LabelB& b, IfExpr const& if_expr, 
+                   Statement const & statement, Statements const&... statements) {
+    typedef typename Statement::label_type label_type;
+    typedef typename label_type::particles_type particles_type;
+    typedef typename std::decay<typename proto::result_of::as_expr<
+        IfExpr const,detail::SymbolicDomain>::type>::type if_expr_type;
+
+    detail::check_sum_statements<if_expr_type,label_type>(
+            static_cast<std::tuple<Statement,Statements...>*>(nullptr));
+
+    ABORIA_PROFILE_ONLY(detail::profile_statement<typename Statement::variable_type,
+            typename Statements::variable_type...> profile;)
+
+    particles_type& particles = statement.label.get_particles();
+    for (particles_type* p: {&particles,&statements.label.get_particles()...}) {
+        CHECK(p == &particles,
+            "statements in a group of neighbour sums do not refer to the same particles container");
+    }
+
+    std::tuple<std::vector<typename Statement::variable_type::value_type>*,
+               std::vector<typename Statements::variable_type::value_type>*...>
+        buffers(&detail::get_evaluate_buffer<typename Statement::variable_type>(
+                        particles,statement.label,
+                        typename detail::sums_in_place<if_expr_type,
+                            Statement,Statement,Statements...>::type()),
+                &detail::get_evaluate_buffer<typename Statements::variable_type>(
+                        particles,statements.label,
+                        typename detail::sums_in_place<if_expr_type,
+                            Statements,Statement,Statements...>::type())...);
+
+    detail::evaluate_sums_impl(particles,proto::value(b),
+            if_expr_type(proto::as_expr<detail::SymbolicDomain>(if_expr)),buffers,
+            detail::make_index_sequence<1+sizeof...(Statements)>(),
+            statement,statements...);
+}
+
+namespace detail {
+
+// the dependency of statement \p Later on an earlier statement \p Earlier,
+// within the group of statements \p All. Equal to 0 if the two statements
+// are independent, 1 if they can be evaluated in the same pass over the
+// particles as long as \p Earlier is evaluated first, and 2 if \p Later
+// must be evaluated in a later pass
+template <typename Later, typename Earlier, typename All>
+struct statement_dependency;
+
+template <typename Later, typename Earlier, typename... All>
+struct statement_dependency<Later,Earlier,std::tuple<All...>> {
+    typedef typename Later::label_type label_type;
+    typedef typename label_type::particles_type::position position;
+    typedef typename Earlier::variable_type earlier_variable;
+    typedef typename Later::variable_type later_variable;
+
+    static const bool read_after_write = 
+        !proto::matches<typename Later::expr_type,
+                        does_not_read<earlier_variable,label_type>>::value;
+    static const bool write_after_read = 
+        !proto::matches<typename Earlier::expr_type,
+                        does_not_read<later_variable,label_type>>::value;
+    static const bool write_after_write = 
+        boost::is_same<earlier_variable,later_variable>::value;
+
+    // buffered variables are only copied back at the end of a pass, and
+    // variables written in-place can only be read by the same particle.
+    // The neighbour search is only updated at the end of a pass, so a 
+    // statement that uses it must not share a pass with a change to 
+    // position or alive on either side
+    static const bool separate_pass = 
+        ((read_after_write || write_after_write) 
+            && !fused_in_place<Earlier,All...>::value)
+        || (read_after_write 
+            && !proto::matches<typename Later::expr_type,
+                        is_not_aliased<earlier_variable,label_type>>::value)
+        || ((boost::is_same<earlier_variable,position>::value 
+                || boost::is_same<earlier_variable,alive>::value) 
+            && !proto::matches<typename Later::expr_type,is_local>::value)
+        || ((boost::is_same<later_variable,position>::value 
+                || boost::is_same<later_variable,alive>::value) 
+            && !proto::matches<typename Earlier::expr_type,is_local>::value);
+
+    static const int value = separate_pass ? 2 : 
+        (read_after_write || write_after_read || write_after_write) ? 1 : 0;
+};
+
+template <typename Later, typename... All>
+void fill_statement_dependencies(int *dependencies, std::tuple<All...>*) {
+    const int row[] = {statement_dependency<Later,All,std::tuple<All...>>::value...};
+    std::copy(row,row+sizeof...(All),dependencies);
+}
+
+// assigns each statement to a pass over the particles. A statement is 
+// evaluated in the first pass in which all the statements it depends on 
+// are either complete or evaluated before it
+template <size_t... I, typename... Statements>
+std::vector<size_t> schedule_statements(index_sequence<I...>, std::tuple<Statements...>* all) {
+    const size_t n = sizeof...(Statements);
+    std::vector<int> dependencies(n*n);
+    int fill[] = {0, (fill_statement_dependencies<Statements>(&dependencies[I*n],all),0)...};
+    (void)fill;
+
+    std::vector<size_t> passes(n,0);
+    for (size_t j=0; j<n; ++j) {
+        for (size_t i=0; i<j; ++i) {
+            switch (dependencies[j*n+i]) {
+                case 1:
+                    passes[j] = std::max(passes[j],passes[i]);
+                    break;
+                case 2:
+                    passes[j] = std::max(passes[j],passes[i]+1);
+                    break;
+            }
+        }
+    }
+    return passes;
+}
+
+template <typename ParticlesType, typename BuffersType, size_t... I, typename... Statements>
+void evaluate_scheduled_impl(ParticlesType& particles, BuffersType& buffers,
+        index_sequence<I...> index, Statements const&... statements) {
+    typedef std::tuple<Statements...> statements_type;
+    const std::vector<size_t> passes = schedule_statements(index,
+            static_cast<statements_type*>(nullptr));
+    const size_t npasses = *std::max_element(passes.begin(),passes.end()) + 1;
+
+    for (size_t pass=0; pass<npasses; ++pass) {
+        std::array<bool,sizeof...(Statements)> active;
+        for (size_t i=0; i<active.size(); ++i) {
+            active[i] = passes[i] == pass;
+        }
+
+        int resize[] = {0, (active[I] ? 
+                    resize_evaluate_buffer(*std::get<I>(buffers),particles.size()) : void(),0)...};
+        (void)resize;
+
+        // evaluate the statements in this pass for each particle in turn
         const size_t n = particles.size();
         #pragma omp parallel for
         for (size_t i=0; i<n; i++) {
-            get<VariableType>(particles[i]) = buffer[i];	
+            int evaluate[] = {0, (active[I] ? 
+                        evaluate_fused_statement(i,particles,*std::get<I>(buffers),statements) : void(),0)...};
+            (void)evaluate;
         }
-    }
 
-    if (boost::is_same<VariableType,position>::value) {
-        particles.update_positions();
+        finish_fused_statements(particles,buffers,
+                std::tuple<typename fused_in_place<Statements,Statements...>::type...>(),
+                index,static_cast<statements_type*>(nullptr),active);
     }
+}
 
-    if (boost::is_same<VariableType,alive>::value) {
-        particles.delete_particles();
+}
+
+/// Evaluates a batch of deferred symbolic assignments, giving the same result 
+/// as evaluating them one after another in the order given. The dependencies
+/// between the statements are found from the variables they read and write, 
+/// and statements that are independent, or that can be fused with the 
+/// statements they depend on, are evaluated together in the same parallel
+/// pass over the particles (see evaluate_fused). For example
+///
+/// evaluate_scheduled(f[a].assign(sum(b,norm(dx)<r,F(dx))),
+///                    v[a].plus_assign(dt*f[a]),
+///                    p[a].plus_assign(dt*v[a]),
+///                    e[a].assign(0.5*dot(v[a],v[a])),
+///                    n[a].assign(sum(b,norm(dx)<r,1)));
+///
+/// evaluates the first four statements in one pass, then updates the 
+/// neighbour search and evaluates the last statement in a second pass. All 
+/// the statements must use the same label.
+template<typename Statement, typename... Statements>
+void evaluate_scheduled(Statement const & statement, Statements const&... statements) {
+    typedef typename Statement::label_type label_type;
+    typedef typename label_type::particles_type particles_type;
+
+    static_assert(std::is_same<
+            std::tuple<label_type,typename Statements::label_type...>,
+            std::tuple<typename Statements::label_type...,label_type>>::value,
+            "all statements in a scheduled batch must use the same label");
+
+    ABORIA_PROFILE_ONLY(detail::profile_statement<typename Statement::variable_type,
+            typename Statements::variable_type...> profile;)
+
+    particles_type& particles = statement.label.get_particles();
+    check_valid_assign_expr(statement.label,statement.expr);
+    int check[] = {0, (check_valid_assign_expr(statements.label,statements.expr),0)...};
+    (void)check;
+    for (particles_type* p: {&particles,&statements.label.get_particles()...}) {
+        CHECK(p == &particles,
+            "statements in a scheduled batch do not refer to the same particles container");
     }
 
+    // if aliased by any statement, or if the label refers to a ParticlesView, 
+    // then a statement writes to a tempory buffer first
+    std::tuple<std::vector<typename Statement::variable_type::value_type>*,
+               std::vector<typename Statements::variable_type::value_type>*...>
+        buffers(&detail::get_evaluate_buffer<typename Statement::variable_type>(
+                        particles,statement.label,
+                        typename detail::fused_in_place<Statement,Statement,Statements...>::type()),
+                &detail::get_evaluate_buffer<typename Statements::variable_type>(
+                        particles,statements.label,
+                        typename detail::fused_in_place<Statements,Statement,Statements...>::type())...);
+
+    detail::evaluate_scheduled_impl(particles,buffers,
+            detail::make_index_sequence<1+sizeof...(Statements)>(),
+            statement,statements...);
 }
 
 /// Evaluates a matrix-free linear operator given by \p expr \p if_expr,
@@ -0,0 +1,160 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+#ifndef INSTANTIATE_H_
+#define INSTANTIATE_H_
+
+#include <tuple>
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include "Particles.h"
+#include "BucketSearchSerial.h"
+#include "BucketSearchParallel.h"
+
+/// \file
+/// Explicit instantiation of the non-template member functions of a 
+/// particle container type and of its neighbour search. To compile these 
+/// once rather than in every translation unit that uses the container, put 
+/// `ABORIA_EXTERN_PARTICLES(MyParticles)` in a header after the typedef of
+/// `MyParticles`, and `ABORIA_INSTANTIATE_PARTICLES(MyParticles)` in one 
+/// source file. Both must appear at global scope. Symbolic evaluation is 
+/// templated on the type of each expression, so it is still compiled where
+/// the expression is written.
+///
+/// The CMake option Aboria_BUILD_LIBRARY builds src/Instantiate.cpp into a
+/// library of the types listed by ABORIA_LIBRARY_PARTICLES. By default these
+/// are the containers with no additional variables in 1-3 dimensions, using 
+/// bucket_search_serial or bucket_search_parallel. To build your own types
+/// instead, set the CMake variable Aboria_LIBRARY_TYPES to a header that 
+/// typedefs them and defines `ABORIA_LIBRARY_PARTICLES(F)` to apply `F` to 
+/// each. This header is included at global scope at the end of Aboria.h, so
+/// it should not include Aboria.h itself, e.g.
+///
+///     namespace mylib {
+///     using namespace Aboria;
+///     ABORIA_VARIABLE(velocity,double3,"velocity")
+///     typedef Particles<std::tuple<velocity>,3> MyParticles;
+///     }
+///     #define ABORIA_LIBRARY_PARTICLES(F) F(mylib::MyParticles)
+///
+/// Code that links against the library must be compiled with 
+/// ABORIA_USE_EXTERN_TEMPLATES and the same ABORIA_LIBRARY_TYPES, so that
+/// the listed types are declared extern.
+
+/// declares (if \p EXTERN is `extern`) or defines (if \p EXTERN is empty) 
+/// the explicit instantiation of the non-template member functions of 
+/// the particle container type \p PARTICLES and its neighbour search. The 
+/// search members are those of neighbour_search_base, which instantiate the 
+/// implementation they dispatch to
+#define ABORIA_PARTICLES_MEMBERS(EXTERN, PARTICLES) \
+    EXTERN template void PARTICLES::push_back(const PARTICLES::value_type&, bool); \
+    EXTERN template void PARTICLES::push_back(const PARTICLES::double_d&); \
+    EXTERN template void PARTICLES::push_back(const PARTICLES&); \
+    EXTERN template void PARTICLES::set_seed(const uint32_t); \
+    EXTERN template void PARTICLES::reserve(const size_t); \
+    EXTERN template void PARTICLES::resize(const size_t); \
+    EXTERN template void PARTICLES::pop_back(bool); \
+    EXTERN template void PARTICLES::clear(); \
+    EXTERN template PARTICLES::iterator PARTICLES::erase(PARTICLES::iterator, bool); \
+    EXTERN template PARTICLES::iterator PARTICLES::erase(PARTICLES::iterator, PARTICLES::iterator); \
+    EXTERN template PARTICLES::iterator PARTICLES::find(const size_t); \
+    EXTERN template PARTICLES::const_iterator PARTICLES::find(const size_t) const; \
+    EXTERN template void PARTICLES::init_neighbour_search(const PARTICLES::double_d&, const PARTICLES::double_d&, const double, const PARTICLES::bool_d&); \
+    EXTERN template void PARTICLES::reset_neighbour_search(const double); \
+    EXTERN template void PARTICLES::update_positions(); \
+    EXTERN template void PARTICLES::delete_particles(const bool); \
+    EXTERN template void PARTICLES::write_checkpoint(std::ostream&) const; \
+    EXTERN template void PARTICLES::write_checkpoint(const std::string&) const; \
+    EXTERN template void PARTICLES::read_checkpoint(std::istream&); \
+    EXTERN template void PARTICLES::read_checkpoint(const std::string&); \
+    EXTERN template void PARTICLES::insert_csv(std::istream&, const char, const size_t); \
+    EXTERN template void PARTICLES::insert_csv(const std::string&, const char); \
+    EXTERN template void PARTICLES::insert_raw(std::istream&, const std::vector<std::string>&); \
+    EXTERN template void PARTICLES::insert_raw(const std::string&, const std::vector<std::string>&); \
+    EXTERN template void PARTICLES::enforce_domain(const PARTICLES::double_d&, const PARTICLES::double_d&, const PARTICLES::bool_d&, const bool); \
+    EXTERN template void PARTICLES::embed_new_particles(const size_t); \
+    EXTERN template void PARTICLES::insert_csv_lines(const std::string&, const size_t, const std::vector<std::string>&, const char); \
+    EXTERN template void PARTICLES::update_id_to_index(const size_t); \
+    EXTERN template void PARTICLES::search_type::neighbour_search_base::set_domain(const PARTICLES::double_d&, const PARTICLES::double_d&, const PARTICLES::bool_d&, const PARTICLES::double_d&, const bool); \
+    EXTERN template void PARTICLES::search_type::neighbour_search_base::embed_points(PARTICLES::iterator, PARTICLES::iterator); \
+    EXTERN template void PARTICLES::search_type::neighbour_search_base::update_iterators(PARTICLES::iterator, PARTICLES::iterator); \
+    EXTERN template void PARTICLES::search_type::neighbour_search_base::add_points_at_end(const PARTICLES::iterator&, const PARTICLES::iterator&, const PARTICLES::iterator&); \
+    EXTERN template void PARTICLES::search_type::neighbour_search_base::copy_points(PARTICLES::iterator, PARTICLES::iterator); \
+    EXTERN template void PARTICLES::search_type::neighbour_search_base::delete_points_at_end(const PARTICLES::iterator&, const PARTICLES::iterator&);
+
+/// declare that the non-template member functions of \p PARTICLES are 
+/// instantiated in another translation unit
+#define ABORIA_EXTERN_PARTICLES(PARTICLES) ABORIA_PARTICLES_MEMBERS(extern, PARTICLES)
+
+/// instantiate the non-template member functions of \p PARTICLES
+#define ABORIA_INSTANTIATE_PARTICLES(PARTICLES) ABORIA_PARTICLES_MEMBERS(, PARTICLES)
+
+#ifdef ABORIA_LIBRARY_TYPES
+#include ABORIA_LIBRARY_TYPES
+#else
+namespace Aboria {
+namespace detail {
+
+typedef Particles<std::tuple<>,1,std::vector,bucket_search_serial> particles_1_serial;
+typedef Particles<std::tuple<>,2,std::vector,bucket_search_serial> particles_2_serial;
+typedef Particles<std::tuple<>,3,std::vector,bucket_search_serial> particles_3_serial;
+typedef Particles<std::tuple<>,1,std::vector,bucket_search_parallel> particles_1_parallel;
+typedef Particles<std::tuple<>,2,std::vector,bucket_search_parallel> particles_2_parallel;
+typedef Particles<std::tuple<>,3,std::vector,bucket_search_parallel> particles_3_parallel;
+
+}
+}
+
+/// apply \p F to each of the particle container types that are 
+/// instantiated in the Aboria library
+#define ABORIA_LIBRARY_PARTICLES(F) \
+    F(Aboria::detail::particles_1_serial) \
+    F(Aboria::detail::particles_2_serial) \
+    F(Aboria::detail::particles_3_serial) \
+    F(Aboria::detail::particles_1_parallel) \
+    F(Aboria::detail::particles_2_parallel) \
+    F(Aboria::detail::particles_3_parallel)
+
+#endif
+
+#ifdef ABORIA_USE_EXTERN_TEMPLATES
+ABORIA_LIBRARY_PARTICLES(ABORIA_EXTERN_PARTICLES)
+#endif
+
+#endif /* INSTANTIATE_H_ */
@@ -0,0 +1,147 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+#ifndef INTEGRATORS_H_
+#define INTEGRATORS_H_
+
+#include "Symbolic.h"
+#include "Evaluate.h"
+
+namespace Aboria {
+
+/// Advances the particles referred to by label \p a by one leapfrog 
+/// (semi-implicit Euler) step of size \p dt. This is equivalent to 
+///
+/// v[a] += dt*acceleration; p[a] += dt*v[a];
+///
+/// but loops over the particles once and updates the neighbour search once.
+/// \param a the label of the particles to advance
+/// \param v the velocity of each particle
+/// \param dt the timestep
+/// \param acceleration an expression for the acceleration of each particle, 
+/// e.g. a sum over neighbouring particles
+template <typename ParticlesType, typename VelocityType, typename AccelerationExpr>
+void leapfrog(Label<0,ParticlesType>& a, Symbol<VelocityType>& v, const double dt, 
+              AccelerationExpr const& acceleration) {
+    Symbol<typename ParticlesType::position> p;
+    evaluate_fused(v[a].plus_assign(dt*acceleration),
+                   p[a].plus_assign(dt*v[a]));
+}
+
+/// Advances the particles referred to by label \p a by one velocity Verlet 
+/// step of size \p dt, i.e. a half step of the velocities, a full step of the
+/// positions, and a second half step of the velocities using the 
+/// acceleration at the new positions. 
+///
+/// The variable \p acc stores the acceleration between steps, and must 
+/// hold the acceleration at the current positions before the first step, 
+/// e.g. `acc[a] = acceleration`. Each step takes two passes over the 
+/// particles and updates the neighbour search once.
+/// \param a the label of the particles to advance
+/// \param v the velocity of each particle
+/// \param acc the acceleration of each particle
+/// \param dt the timestep
+/// \param acceleration an expression for the acceleration of each particle, 
+/// e.g. a sum over neighbouring particles
+template <typename ParticlesType, typename VelocityType, typename AccelerationType, 
+          typename AccelerationExpr>
+void velocity_verlet(Label<0,ParticlesType>& a, Symbol<VelocityType>& v, 
+                     Symbol<AccelerationType>& acc, const double dt, 
+                     AccelerationExpr const& acceleration) {
+    Symbol<typename ParticlesType::position> p;
+    evaluate_fused(v[a].plus_assign(0.5*dt*acc[a]),
+                   p[a].plus_assign(dt*v[a]));
+    evaluate_fused(acc[a].assign(acceleration),
+                   v[a].plus_assign(0.5*dt*acc[a]));
+}
+
+/// Advances the variable \p y of the particles referred to by label \p a 
+/// by one step of size \p dt of the ODE `dy/dt = f`, using the second order
+/// (midpoint) Runge-Kutta method. Each step takes two passes over the 
+/// particles.
+/// \param a the label of the particles to advance
+/// \param y the variable to advance
+/// \param y0 a variable with the same type as \p y, used to store the value 
+/// of \p y at the start of the step
+/// \param dt the timestep
+/// \param f an expression for the derivative of \p y, which can depend on 
+/// \p y and on neighbouring particles
+template <typename ParticlesType, typename YType, typename Y0Type, typename DerivativeExpr>
+void runge_kutta2(Label<0,ParticlesType>& a, Symbol<YType>& y, Symbol<Y0Type>& y0, 
+                  const double dt, DerivativeExpr const& f) {
+    evaluate_fused(y0[a].assign(y[a]),
+                   y[a].plus_assign(0.5*dt*f));
+    evaluate_fused(y[a].assign(y0[a] + dt*f));
+}
+
+/// Advances the variable \p y of the particles referred to by label \p a 
+/// by one step of size \p dt of the ODE `dy/dt = f`, using the classical 
+/// fourth order Runge-Kutta method. Each step takes four passes over the 
+/// particles.
+/// \param a the label of the particles to advance
+/// \param y the variable to advance
+/// \param y0 a variable with the same type as \p y, used to store the value 
+/// of \p y at the start of the step
+/// \param k a variable with the same type as \p y, used to store the 
+/// derivative at each stage 
+/// \param ksum a variable with the same type as \p y, used to store the 
+/// weighted sum of the derivatives
+/// \param dt the timestep
+/// \param f an expression for the derivative of \p y, which can depend on 
+/// \p y and on neighbouring particles
+template <typename ParticlesType, typename YType, typename Y0Type, 
+          typename KType, typename KSumType, typename DerivativeExpr>
+void runge_kutta4(Label<0,ParticlesType>& a, Symbol<YType>& y, Symbol<Y0Type>& y0, 
+                  Symbol<KType>& k, Symbol<KSumType>& ksum,
+                  const double dt, DerivativeExpr const& f) {
+    evaluate_fused(y0[a].assign(y[a]),
+                   k[a].assign(f),
+                   ksum[a].assign(k[a]),
+                   y[a].assign(y0[a] + 0.5*dt*k[a]));
+    evaluate_fused(k[a].assign(f),
+                   ksum[a].plus_assign(2*k[a]),
+                   y[a].assign(y0[a] + 0.5*dt*k[a]));
+    evaluate_fused(k[a].assign(f),
+                   ksum[a].plus_assign(2*k[a]),
+                   y[a].assign(y0[a] + dt*k[a]));
+    evaluate_fused(k[a].assign(f),
+                   y[a].assign(y0[a] + (dt/6.0)*(ksum[a] + k[a])));
+}
+
+}
+
+#endif /* INTEGRATORS_H_ */
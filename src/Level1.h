@@ -48,6 +48,11 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Traits.h"
 #include "Get.h"
 #include "Particles.h"
+#include "ParticlesView.h"
+#include "ParticlesArray.h"
+#include "VtuWriter.h"
+#include "AsyncWriter.h"
+#include "Trajectory.h"
 #include "BucketSearchSerial.h"
 #include "BucketSearchParallel.h"
 #include "PrintTuple.h"
@@ -0,0 +1,333 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+#ifndef MMAP_VECTOR_H_
+#define MMAP_VECTOR_H_
+
+// mmap_vector uses POSIX memory mapping, and is not available on Windows
+#ifndef _WIN32
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Log.h"
+
+namespace Aboria {
+
+namespace detail {
+
+/// a private memory mapping of a whole file, which is unmapped on 
+/// destruction. Pages are loaded lazily by the operating system as they
+/// are accessed. The mapping is copy-on-write, so the file itself is never
+/// altered
+class mmap_region {
+public:
+    mmap_region(const std::string& filename):
+        m_data(MAP_FAILED),
+        m_size(0)
+    {
+        const int fd = ::open(filename.c_str(),O_RDONLY);
+        CHECK(fd >= 0,"could not open "<<filename<<" for mapping");
+        struct stat st;
+        CHECK(::fstat(fd,&st) == 0,"could not stat "<<filename);
+        m_size = st.st_size;
+        if (m_size > 0) {
+            m_data = ::mmap(NULL,m_size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0);
+        }
+        ::close(fd);
+        CHECK(m_data != MAP_FAILED,"could not map "<<filename);
+    }
+
+    ~mmap_region() {
+        if (m_data != MAP_FAILED) {
+            ::munmap(m_data,m_size);
+        }
+    }
+
+    mmap_region(const mmap_region&) = delete;
+    mmap_region& operator=(const mmap_region&) = delete;
+
+    char* data() const { return static_cast<char*>(m_data); }
+    size_t size() const { return m_size; }
+
+private:
+    void* m_data;
+    size_t m_size;
+};
+
+}
+
+/// \brief A vector that can either own its elements (like std::vector) or 
+/// refer to a range of a memory-mapped file
+///
+/// mmap_vector can be used as the `VECTOR` template argument of Particles, 
+/// so that Particles::map_checkpoint() can map each variable directly from
+/// a checkpoint file, without reading or parsing it. Only the pages that
+/// are accessed are read from disk.
+///
+/// Elements of a mapped vector can be altered, but the changes are private
+/// to the process and are not written to the file. Any operation that 
+/// changes the capacity of a mapped vector (e.g. push_back, insert, or 
+/// growing with resize) first copies the mapped range into owned storage.
+///
+/// mmap_vector is not available on Windows.
+///
+/// \param T the element type
+/// \param Alloc the allocator used for owned storage
+template <typename T, typename Alloc = std::allocator<T>>
+class mmap_vector {
+    typedef std::vector<T,Alloc> owned_type;
+public:
+    typedef T value_type;
+    typedef Alloc allocator_type;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    mmap_vector():
+        m_mapped(NULL),
+        m_mapped_size(0)
+    {}
+
+    explicit mmap_vector(size_type n, const T& value = T()):
+        m_owned(n,value),
+        m_mapped(NULL),
+        m_mapped_size(0)
+    {}
+
+    template <typename InputIterator>
+    mmap_vector(InputIterator first, InputIterator last):
+        m_owned(first,last),
+        m_mapped(NULL),
+        m_mapped_size(0)
+    {}
+
+    /// copying a mapped vector copies its elements into owned storage, as
+    /// the copies would otherwise share writes to the mapping
+    mmap_vector(const mmap_vector& other):
+        m_owned(other.begin(),other.end()),
+        m_mapped(NULL),
+        m_mapped_size(0)
+    {}
+
+    mmap_vector(mmap_vector&& other):
+        m_owned(std::move(other.m_owned)),
+        m_region(std::move(other.m_region)),
+        m_mapped(other.m_mapped),
+        m_mapped_size(other.m_mapped_size)
+    {
+        other.m_mapped = NULL;
+        other.m_mapped_size = 0;
+    }
+
+    mmap_vector& operator=(const mmap_vector& other) {
+        if (this != &other) {
+            owned_type tmp(other.begin(),other.end());
+            unmap();
+            m_owned.swap(tmp);
+        }
+        return *this;
+    }
+
+    mmap_vector& operator=(mmap_vector&& other) {
+        swap(other);
+        return *this;
+    }
+
+    /// refer to \p n elements starting at byte \p offset in the mapping
+    /// \p region, discarding the current contents
+    void map(const std::shared_ptr<detail::mmap_region>& region, 
+             const size_t offset, const size_t n) {
+        CHECK(offset % alignof(T) == 0,"mapped offset "<<offset<<" is not aligned");
+        CHECK(offset + n*sizeof(T) <= region->size(),"mapped range is larger than the file");
+        owned_type().swap(m_owned);
+        m_region = region;
+        m_mapped = reinterpret_cast<T*>(region->data() + offset);
+        m_mapped_size = n;
+    }
+
+    /// returns true if the vector refers to a memory-mapped file
+    bool is_mapped() const { return m_region != nullptr; }
+
+    size_type size() const { return is_mapped() ? m_mapped_size : m_owned.size(); }
+    size_type capacity() const { return is_mapped() ? m_mapped_size : m_owned.capacity(); }
+    bool empty() const { return size() == 0; }
+
+    pointer data() { return is_mapped() ? m_mapped : m_owned.data(); }
+    const_pointer data() const { return is_mapped() ? m_mapped : m_owned.data(); }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + size(); }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + size(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    reference operator[](size_type i) { return data()[i]; }
+    const_reference operator[](size_type i) const { return data()[i]; }
+    reference front() { return *begin(); }
+    const_reference front() const { return *begin(); }
+    reference back() { return *(end()-1); }
+    const_reference back() const { return *(end()-1); }
+
+    void clear() {
+        unmap();
+        m_owned.clear();
+    }
+
+    /// shrinking a mapped vector keeps the mapping
+    void resize(size_type n, const T& value = T()) {
+        if (is_mapped() && n <= m_mapped_size) {
+            m_mapped_size = n;
+        } else {
+            detach();
+            m_owned.resize(n,value);
+        }
+    }
+
+    void reserve(size_type n) {
+        if (n > capacity()) {
+            detach();
+            m_owned.reserve(n);
+        }
+    }
+
+    void assign(size_type n, const T& value) {
+        unmap();
+        m_owned.assign(n,value);
+    }
+
+    template <typename InputIterator, typename = typename 
+        std::enable_if<!std::is_integral<InputIterator>::value>::type>
+    void assign(InputIterator first, InputIterator last) {
+        owned_type tmp(first,last);
+        unmap();
+        m_owned.swap(tmp);
+    }
+
+    void push_back(const T& value) {
+        detach();
+        m_owned.push_back(value);
+    }
+
+    void pop_back() {
+        if (is_mapped()) {
+            --m_mapped_size;
+        } else {
+            m_owned.pop_back();
+        }
+    }
+
+    iterator insert(const_iterator position, const T& value) {
+        const size_t i = position - begin();
+        detach();
+        m_owned.insert(m_owned.begin()+i,value);
+        return begin()+i;
+    }
+
+    iterator insert(const_iterator position, size_type n, const T& value) {
+        const size_t i = position - begin();
+        detach();
+        m_owned.insert(m_owned.begin()+i,n,value);
+        return begin()+i;
+    }
+
+    template <typename InputIterator>
+    iterator insert(const_iterator position, InputIterator first, InputIterator last) {
+        const size_t i = position - begin();
+        detach();
+        m_owned.insert(m_owned.begin()+i,first,last);
+        return begin()+i;
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        const size_t i = first - begin();
+        const size_t j = last - begin();
+        detach();
+        m_owned.erase(m_owned.begin()+i,m_owned.begin()+j);
+        return begin()+i;
+    }
+
+    iterator erase(const_iterator position) {
+        return erase(position,position+1);
+    }
+
+    void swap(mmap_vector& other) {
+        m_owned.swap(other.m_owned);
+        m_region.swap(other.m_region);
+        std::swap(m_mapped,other.m_mapped);
+        std::swap(m_mapped_size,other.m_mapped_size);
+    }
+
+private:
+    /// copy a mapped range into owned storage
+    void detach() {
+        if (is_mapped()) {
+            owned_type tmp(m_mapped,m_mapped+m_mapped_size);
+            m_owned.swap(tmp);
+            unmap();
+        }
+    }
+
+    void unmap() {
+        m_region.reset();
+        m_mapped = NULL;
+        m_mapped_size = 0;
+    }
+
+    owned_type m_owned;
+    std::shared_ptr<detail::mmap_region> m_region;
+    T* m_mapped;
+    size_t m_mapped_size;
+};
+
+}
+
+#endif /* _WIN32 */
+#endif /* MMAP_VECTOR_H_ */
@@ -38,8 +38,14 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PARTICLES_H_
 
 #include <vector>
+#include <array>
 #include <random>
 #include <string>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstring>
+#include <cstdlib>
 //#include <boost/array.hpp>
 //#include <boost/iterator/iterator_facade.hpp>
 #include <boost/iterator/counting_iterator.hpp>
@@ -50,6 +56,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Vector.h"
 #include "Variable.h"
 #include "Traits.h"
+#include "MmapVector.h"
 #include "BucketSearchSerial.h"
 //#include "OctTree.h"
 #include "CudaInclude.h"
@@ -62,6 +69,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vtkPointData.h>
 #include <vtkCellArray.h>
 #include <vtkUnsignedCharArray.h>
+#include <vtkAOSDataArrayTemplate.h>
+#include <vtkIdTypeArray.h>
+#include <vtkCellType.h>
 #endif
 
 #include "detail/Particles.h"
@@ -69,11 +79,11 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace Aboria {
 namespace detail {
-template <unsigned int D, typename Reference>
+template <unsigned int D, typename Reference, typename Position=position_d<D>>
 struct enforce_domain_impl {
     typedef Vector<double,D> double_d;
     typedef Vector<bool,D> bool_d;
-    typedef position_d<D> position;
+    typedef Position position;
     static const unsigned int dimension = D;
     const double_d low,high;
     const bool_d periodic;
@@ -136,6 +146,16 @@ using default_vector = std::vector<T,Alloc>;
 ///     MyParticles particles();
 ///  \endcode
 ///
+///  Positions are stored in double precision by default. To store them in 
+///  single precision use `Traits<VECTOR,float>` for the \p TRAITS_USER 
+///  parameter. The neighbour search and the `dx` between pairs of particles 
+///  are still calculated in double precision.
+///
+///  \code 
+///     typedef Particles<std::tuple<scalar>,3,std::vector,
+///                       bucket_search_serial,Traits<std::vector,float>> MyParticles;
+///  \endcode
+///
 ///  \param TYPES a list of one or more variable types
 ///
 ///  \see #ABORIA_VARIABLE
@@ -226,14 +246,20 @@ public:
     Particles():
         next_id(0),
         searchable(false),
-        seed(time(NULL))
+        seed(time(NULL)),
+        search_incomplete(false),
+        generation(),
+        structure_generation(0)
     {}
 
     /// Constructs a container with `size` particles
     Particles(const size_t size):
         next_id(0),
         searchable(false),
-        seed(time(NULL))
+        seed(time(NULL)),
+        search_incomplete(false),
+        generation(),
+        structure_generation(0)
     {
         traits_type::resize(data,size);         
         for (int i=0; i<size; ++i) {
@@ -243,6 +269,7 @@ public:
                         seed + uint32_t(Aboria::get<id>(data)[i])
                     );
         }
+        update_id_to_index();
     }
 
     /// copy-constructor. performs deep copying of all particles
@@ -252,17 +279,54 @@ public:
             next_id(other.next_id),
             searchable(other.searchable),
             seed(other.seed),
-            id_to_index(other.id_to_index)
-    {}
+            id_to_index(other.id_to_index),
+            search_incomplete(other.search_incomplete),
+            generation(other.generation),
+            structure_generation(other.structure_generation)
+    {
+        rebuild_search_after_copy();
+    }
+
+    /// copy-assignment. performs deep copying of all particles, and points
+    /// the neighbourhood search and id lookup at the new copy. The 
+    /// generation of every variable changes
+    /// \see get_generation()
+    particles_type& operator=(const particles_type &other) {
+        if (this == &other) return *this;
+        data = other.data;
+        search = other.search;
+        next_id = other.next_id;
+        searchable = other.searchable;
+        seed = other.seed;
+        id_to_index = other.id_to_index;
+        search_incomplete = other.search_incomplete;
+        rebuild_search_after_copy();
+        mark_all_dirty();
+        return *this;
+    }
 
     /// range-based copy-constructor. performs deep copying of all 
     /// particles from \p first to \p last
     Particles(iterator first, iterator last):
-        data(first,last),
         searchable(false),
-        seed(0)
+        next_id(0),
+        seed(0),
+        search_incomplete(false),
+        generation(),
+        structure_generation(0)
     {
-        if (searchable) embed_points(begin(),end());
+        const size_t n = std::distance(first,last);
+        traits_type::resize(data,n);
+        #pragma omp parallel for
+        for (size_t i=0; i<n; ++i) {
+            (*this)[i] = *(first+i);
+        }
+
+        // the particles keep their ids, so new ids start after the largest
+        for (size_t i=0; i<n; ++i) {
+            next_id = std::max(next_id,int(Aboria::get<id>(data)[i])+1);
+        }
+        update_id_to_index();
     }
 
     
@@ -273,11 +337,12 @@ public:
     /// push the particle \p val to the back of the container (if its within
     /// the searchable domain)
     void push_back (const value_type& val, bool update_neighbour_search=true) {
+        mark_all_dirty();
         traits_type::push_back(data,val);
         reference i = *(end()-1);
         Aboria::get<alive>(i) = true;
         if (searchable) {
-            detail::enforce_domain_impl<traits_type::dimension,reference> enforcer(search.get_min(),search.get_max(),search.get_periodic());
+            detail::enforce_domain_impl<traits_type::dimension,reference,position> enforcer(search.get_min(),search.get_max(),search.get_periodic());
             enforcer(i);
         }
         if (get<alive>(i)) {
@@ -286,6 +351,12 @@ public:
             if (searchable && update_neighbour_search) {
                 search.add_points_at_end(begin(),end()-1,end());
             }
+            if (searchable && update_neighbour_search && !search.unordered()) {
+                // the ordered search may have moved any of the particles
+                update_id_to_index();
+            } else {
+                update_id_to_index(size()-1);
+            }
         } else {
             LOG(2,"WARNING: particle you tried to push back with r = "<<Aboria::get<position>(i)<<" is outside the domain and has been removed");
             pop_back(false);
@@ -297,10 +368,13 @@ public:
     /// set the base seed of the container. Note that the random number generator for
     /// each particle is set to \p value plus the particle's id
     void set_seed(const uint32_t value) {
+        mark_dirty<random>();
         seed = value;
-        for (size_t i=0; i<size(); ++i) {
-            Aboria::get<random>(data[i]).seed(
-                        seed + uint32_t(Aboria::get<id>(data[i]))
+        const size_t n = size();
+        #pragma omp parallel for
+        for (size_t i=0; i<n; ++i) {
+            Aboria::get<random>(data)[i].seed(
+                        seed + uint32_t(Aboria::get<id>(data)[i])
                     );
         }
     }
@@ -314,12 +388,86 @@ public:
     }
 
     /// push the particles in \p particles to the back of the container
+    /// \see insert_bulk()
     void push_back (const particles_type& particles) {
-        for (const value_type& i: particles) {
-            this->push_back(i,false);
+        const size_t old_size = size();
+        const size_t n = particles.size();
+        traits_type::resize(data,old_size+n);
+        #pragma omp parallel for
+        for (size_t i=0; i<n; ++i) {
+            (*this)[old_size+i] = particles[i];
         }
-        if (searchable) {
-            search.add_points_at_end(data.begin(),data.end()-particles.size(),data.end());
+        embed_new_particles(old_size);
+    }
+
+    /// push the particles pointed to by the random access iterators \p first 
+    /// and \p last to the back of the container. Each variable is grown 
+    /// once, the new particles are given ids and random seeds in parallel and
+    /// the neighbourhood search (if on) is updated once for all the new 
+    /// particles. Any new particles outside the (non-periodic) search domain
+    /// are removed
+    template <typename InputIterator>
+    void insert_bulk(InputIterator first, InputIterator last) {
+        const size_t old_size = size();
+        const size_t n = std::distance(first,last);
+        traits_type::resize(data,old_size+n);
+        #pragma omp parallel for
+        for (size_t i=0; i<n; ++i) {
+            (*this)[old_size+i] = *(first+i);
+        }
+        embed_new_particles(old_size);
+    }
+
+    /// reserve memory for at least \p n particles in every variable
+    void reserve(const size_t n) {
+        traits_type::reserve(data,n);
+    }
+
+    /// resize the container to hold \p n particles. New particles are 
+    /// default-constructed and given a new id and random seed. Together with
+    /// operator[] this can be used to add many particles without growing
+    /// each variable once per particle. If neighbourhood searching is on, 
+    /// the new particles are placed at the lower corner of the domain, keep 
+    /// their index in the container, and update_positions() must be called 
+    /// after their positions are set. With an ordered neighbourhood search 
+    /// the new particles are left out of the search until then, and 
+    /// get_query() checks (in all builds) that update_positions() has been
+    /// called
+    void resize(const size_t n) {
+        mark_all_dirty();
+        const size_t old_size = size();
+        traits_type::resize(data,n);
+        if (n > old_size) {
+            #pragma omp parallel for
+            for (size_t i=old_size; i<n; ++i) {
+                Aboria::get<alive>(data)[i] = true;
+                Aboria::get<id>(data)[i] = next_id + i - old_size;
+                Aboria::get<random>(data)[i].seed(
+                        seed + uint32_t(Aboria::get<id>(data)[i])
+                    );
+                if (searchable) {
+                    Aboria::get<position>(data)[i] = search.get_min();
+                }
+            }
+            next_id += n - old_size;
+            if (searchable) {
+                if (search.unordered()) {
+                    search.add_points_at_end(begin(),begin()+old_size,end());
+                } else {
+                    // an ordered search would move the new particles, so 
+                    // leave them out until update_positions() is called
+                    search.update_iterators(begin(),begin()+old_size);
+                    search_incomplete = true;
+                }
+            }
+            update_id_to_index(old_size);
+        } else if (searchable && n < old_size) {
+            if (search.unordered()) {
+                search.delete_points_at_end(begin(),end());
+            } else {
+                embed_all_points();
+                update_id_to_index();
+            }
         }
     }
 
@@ -355,21 +503,36 @@ public:
         return traits_type::end(data);
     }
 
+    /// returns a const_iterator to the beginning of the container
+    const_iterator cbegin() const {
+        return traits_type::cbegin(data);
+    }
+
     /// sets container to empty and deletes all particles
     void clear() {
-        return traits_type::clear(data);
+        mark_all_dirty();
+        traits_type::clear(data);
+        if (searchable) {
+            if (search.unordered()) {
+                search.delete_points_at_end(begin(),end());
+            } else {
+                embed_all_points();
+            }
+        }
     }
 
     /// erase the particle pointed to by the iterator \p i.
     /// NOTE: This will potentially reorder the particles
     /// if neighbourhood searching is on, then this is updated
     iterator erase (iterator i, bool update_neighbour_search = true) {
+        mark_all_dirty();
         if (i != end()-1) {
             *i = *(end()-1);
             if (search.unordered() && searchable) {
                 search.copy_points(end()-1,i);
             }
             traits_type::pop_back(data);
+            id_to_index[Aboria::get<id>(*i)] = i-begin();
         } else {
             traits_type::pop_back(data);
             i = end();
@@ -378,7 +541,8 @@ public:
             if (search.unordered()) {
                 search.delete_points_at_end(begin(),end());
             } else {
-                search.embed_points(begin(),end());
+                embed_all_points();
+                update_id_to_index();
             }
         }
         return i;
@@ -399,7 +563,8 @@ public:
                 if (search.unordered()) {
                     search.delete_points_at_end(begin(),end());
                 } else {
-                    search.embed_points(begin(),end());
+                    embed_all_points();
+                    update_id_to_index();
                 }
             }
         }
@@ -408,21 +573,46 @@ public:
 
     /// insert a particle \p val into the container at \p position
     iterator insert (iterator position, const value_type& val) {
+        mark_all_dirty();
         traits_type::insert(data,position,val);
     }
 
     /// insert a \p n copies of the particle \p val into the container at \p position
     void insert (iterator position, size_type n, const value_type& val) {
+        mark_all_dirty();
         traits_type::insert(data,position,n,val);
     }
 
     /// insert a range of particles pointed to by \p first and \p last at \p position 
     template <class InputIterator>
     void insert (iterator position, InputIterator first, InputIterator last) {
+        mark_all_dirty();
         traits_type::insert(data,position,first,last);
         data.insert(position,first,last);
     }
 
+    /// returns an iterator to the particle with id \p particle_id, or end() 
+    /// if there is no such particle in the container. This is an O(1) 
+    /// lookup which remains valid after particles are added, deleted or 
+    /// reordered by the neighbourhood search. The lookup table is kept up
+    /// to date by every function that changes the particles, so find() 
+    /// only reads it and can be called concurrently (e.g. from an OpenMP 
+    /// loop over bonded pairs).
+    ///
+    /// The table has one entry for every id that has been given out, so 
+    /// its size is the total number of particles ever added to the 
+    /// container rather than the current number of particles
+    iterator find(const size_t particle_id) {
+        return begin() + find_index(particle_id);
+    }
+
+    /// returns a const_iterator to the particle with id \p particle_id, or
+    /// end() if there is no such particle in the container
+    /// \see find(const size_t)
+    const_iterator find(const size_t particle_id) const {
+        return cbegin() + find_index(particle_id);
+    }
+
     /// return the total number of particles in the container
     size_t size() const {
         return Aboria::get<position>(data).size();
@@ -449,7 +639,11 @@ public:
         searchable = true;
     }
 
+    /// returns the query object used to search for neighbouring particles.
+    /// After resize() with an ordered neighbourhood search, update_positions()
+    /// must be called first
     const query_type& get_query() const {
+        CHECK(!search_incomplete,"new particles are not in the neighbourhood search, call update_positions() after resize()");
         return search.get_query();
     }
 
@@ -460,7 +654,9 @@ public:
                                     search.get_max(),
                                     search.get_periodic(),
                                     double_d(length_scale));
-        search.embed_points(begin(),end());
+        mark_all_dirty();
+        embed_all_points();
+        update_id_to_index();
         searchable = true;
     }
 
@@ -530,7 +726,7 @@ public:
             while (Aboria::get<alive>(*i) == false) {
                 if ((index < size()-1) && (size() > 1)) {
                     *i = *(end()-1);
-                    if (search.unordered()) {
+                    if (search.unordered() && searchable) {
                         search.copy_points(end()-1,i);
                     }
                     pop_back(false);
@@ -545,9 +741,57 @@ public:
             if (search.unordered()) {
                 search.delete_points_at_end(begin(),end());
             } else {
-                search.embed_points(begin(),end());
+                embed_all_points();
             }
         }
+        update_id_to_index();
+    }
+
+    /// returns the generation of variable \p T. This is a counter that is
+    /// incremented whenever \p T might have changed: by a symbolic 
+    /// assignment to \p T, by a member function that writes \p T (e.g. 
+    /// swap_variable()), or by any change to the number or order of the 
+    /// particles. Writers and caches can store the generation and skip 
+    /// their work if it has not changed. Writes through the accessors 
+    /// (e.g. `get<T>(particles)[i] = x` or `get<T>(particles[i]) = x`) are
+    /// not tracked, so that they stay as cheap as a plain vector access, 
+    /// call mark_dirty() once after these
+    template <typename T>
+    size_t get_generation() const {
+        return generation[elem_by_type<T>::index] + structure_generation;
+    }
+
+    /// record that variable \p T has changed
+    /// \see get_generation()
+    template <typename T>
+    void mark_dirty() {
+        #pragma omp atomic
+        ++generation[elem_by_type<T>::index];
+    }
+
+    /// swap the values of variable \p T with the contents of \p values, 
+    /// which must hold one value for each particle. This replaces the whole
+    /// variable without copying it, and \p values is left holding the old
+    /// values. Since the storage of \p T is exchanged, any pointer into it 
+    /// (e.g. from `get<T>(particles).data()`, get_grid_view() or the NumPy
+    /// arrays of the python bindings) is left pointing at the old values. 
+    /// Aliased symbolic assignments to \p T use this function, see 
+    /// evaluate_nonlinear()
+    template <typename T, typename VectorType>
+    void swap_variable(VectorType& values) {
+        CHECK(values.size() == size(),"swap_variable: values has size "<<values.size()<<", but there are "<<size()<<" particles");
+        Aboria::get<T>(data).swap(values);
+        mark_dirty<T>();
+        if (searchable) {
+            search.update_iterators(begin(),end());
+        }
+    }
+
+    /// record that every variable has changed
+    /// \see get_generation()
+    void mark_all_dirty() {
+        #pragma omp atomic
+        ++structure_generation;
     }
 
     // Need to be mark as device to enable get functions being device/host
@@ -582,6 +826,236 @@ public:
     */
 
 
+    /// write a binary checkpoint of the container to \p os. The checkpoint
+    /// holds a header with the dimension, number of particles, next id, base 
+    /// seed and neighbourhood search settings, followed by each variable 
+    /// (including position, id, alive and the random generator state) 
+    /// written directly from its column in the native binary format. 
+    /// Each column starts at a multiple of detail::checkpoint_alignment 
+    /// bytes so that it can be mapped with map_checkpoint(). 
+    /// All variables must be trivially copyable
+    /// \see read_checkpoint()
+    void write_checkpoint(std::ostream& os) const {
+        LOG(2,"Particles: write_checkpoint: writing "<<size()<<" particles");
+        detail::checkpoint_header<dimension> header;
+        header.ncolumns = mpl::size<mpl_type_vector>::type::value;
+        header.n = size();
+        header.next_id = next_id;
+        header.seed = seed;
+        header.searchable = searchable;
+        header.low = get_min();
+        header.high = get_max();
+        header.periodic = get_periodic();
+        // store the number of buckets rather than the bucket side length 
+        // so that read_checkpoint() recreates exactly the same grid
+        if (searchable) {
+            header.nbuckets = round((get_max()-get_min())/search.get_min_bucket_size());
+        }
+        header.write(os);
+        mpl::for_each<mpl::range_c<int,0,mpl::size<mpl_type_vector>::type::value>>(
+                detail::write_column<data_type>(os,data));
+        CHECK(os,"error writing checkpoint");
+    }
+
+    /// write a binary checkpoint of the container to the file \p filename
+    /// \see write_checkpoint(std::ostream&)
+    void write_checkpoint(const std::string& filename) const {
+        std::ofstream os(filename,std::ios::binary);
+        CHECK(os,"could not open "<<filename<<" for writing");
+        write_checkpoint(os);
+    }
+
+    /// restore the container from a binary checkpoint written by 
+    /// write_checkpoint(). The particle data, ids, random generator states, 
+    /// base seed and neighbourhood search settings are restored exactly, 
+    /// and the particles are in the same order as when the checkpoint 
+    /// was written (for an ordered neighbourhood search, as long as the 
+    /// search was up to date)
+    void read_checkpoint(std::istream& is) {
+        const detail::checkpoint_header<dimension> header = read_checkpoint_header(is);
+        LOG(2,"Particles: read_checkpoint: reading "<<header.n<<" particles");
+        mark_all_dirty();
+
+        traits_type::resize(data,header.n);
+        mpl::for_each<mpl::range_c<int,0,mpl::size<mpl_type_vector>::type::value>>(
+                detail::read_column<data_type>(is,data));
+        next_id = header.next_id;
+        seed = header.seed;
+        searchable = header.searchable;
+        if (searchable) {
+            // the half bucket ensures that the search recovers the same 
+            // number of buckets
+            search.set_domain(header.low,header.high,header.periodic,
+                              (header.high-header.low)/(header.nbuckets+0.5));
+            if (search.unordered()) {
+                embed_all_points();
+            } else {
+                // the particles were written in bucket order, but sorting 
+                // them by bucket again can change their order within each 
+                // bucket. Put them back in the order they were written
+                std::vector<size_t> written_order(next_id);
+                for (size_t i=0; i<header.n; ++i) {
+                    written_order[Aboria::get<id>(data)[i]] = i;
+                }
+                embed_all_points();
+                restore_order_within_buckets(written_order);
+            }
+        }
+        update_id_to_index();
+    }
+
+    /// restore the container from the binary checkpoint file \p filename
+    /// \see read_checkpoint(std::istream&)
+    void read_checkpoint(const std::string& filename) {
+        std::ifstream is(filename,std::ios::binary);
+        CHECK(is,"could not open "<<filename<<" for reading");
+        read_checkpoint(is);
+    }
+
+#ifndef _WIN32
+    /// map each variable of the binary checkpoint file \p filename directly
+    /// into memory, rather than reading it. This requires that `VECTOR` is
+    /// mmap_vector, and is not available on Windows. Nothing is read from 
+    /// the file until a variable is accessed, and then only the pages that
+    /// are accessed, so a job that only uses a few variables only reads 
+    /// those from disk. Any changes to the particles are private to this 
+    /// process.
+    ///
+    /// The neighbourhood search is not restored, as embedding the particles
+    /// would read every variable. Call init_neighbour_search() if needed. 
+    /// The lookup table used by find() is built here, so the id variable
+    /// is always read
+    /// \see write_checkpoint(), mmap_vector
+    void map_checkpoint(const std::string& filename) {
+        std::shared_ptr<detail::mmap_region> region = 
+            std::make_shared<detail::mmap_region>(filename);
+        std::ifstream is(filename,std::ios::binary);
+        CHECK(is,"could not open "<<filename<<" for reading");
+        const detail::checkpoint_header<dimension> header = read_checkpoint_header(is);
+        LOG(2,"Particles: map_checkpoint: mapping "<<header.n<<" particles");
+        mark_all_dirty();
+
+        mpl::for_each<mpl::range_c<int,0,mpl::size<mpl_type_vector>::type::value>>(
+                detail::map_column<data_type>(is,data,region,header.n));
+        next_id = header.next_id;
+        seed = header.seed;
+        searchable = false;
+        update_id_to_index();
+    }
+#endif
+
+    /// append the particles read from the comma separated values in \p is.
+    ///
+    /// The first line is a header giving the name of the variable (see 
+    /// Variable::name) stored in each column. Each component of a Vector 
+    /// variable has its own column, named by the variable name followed by
+    /// "_" and the component index (e.g. "position_0", "position_1"). 
+    /// Columns that do not match a variable are ignored and variables 
+    /// without a column are default-initialised. Ids, random seeds and the
+    /// neighbourhood search are set up once for all the new particles, as 
+    /// for insert_bulk().
+    ///
+    /// The stream is read in chunks of about \p chunk_size bytes, so only 
+    /// one chunk is held in memory at a time. The lines in each chunk are 
+    /// parsed in parallel directly into the variables
+    void insert_csv(std::istream& is, const char delimiter = ',',
+                    const size_t chunk_size = size_t(1) << 24) {
+        std::string header;
+        std::getline(is,header);
+        const std::vector<std::string> names = detail::split_csv_line(header,delimiter);
+
+        const size_t old_size = size();
+        std::string text;
+        std::string partial_line;
+        while (is) {
+            // a chunk starts with the unfinished last line of the previous one
+            text.swap(partial_line);
+            const size_t carried = text.size();
+            text.resize(carried+chunk_size);
+            is.read(&text[carried],chunk_size);
+            text.resize(carried+is.gcount());
+
+            size_t end = text.size();
+            if (is) {
+                const size_t last_newline = text.rfind('\n');
+                end = last_newline == std::string::npos ? 0 : last_newline+1;
+            }
+            partial_line.assign(text,end,std::string::npos);
+            insert_csv_lines(text,end,names,delimiter);
+        }
+        LOG(2,"insert_csv: read "<<size()-old_size<<" particles");
+        embed_new_particles(old_size);
+    }
+
+    /// append the particles read from the comma separated values in the file
+    /// \p filename
+    /// \see insert_csv(std::istream&,const char)
+    void insert_csv(const std::string& filename, const char delimiter = ',') {
+        std::ifstream is(filename);
+        CHECK(is,"could not open "<<filename<<" for reading");
+        insert_csv(is,delimiter);
+    }
+
+    /// append the particles read from the raw binary records in \p is. 
+    ///
+    /// Each record holds the variables named by \p names (see 
+    /// Variable::name), in that order, with no padding and in the native
+    /// type and byte order of each variable. As for insert_csv(), each 
+    /// component of a Vector variable is named separately. The number of 
+    /// records is found from the length of the stream, all the variables 
+    /// are grown once, and the records are read in blocks that are copied 
+    /// into the variables in parallel
+    void insert_raw(std::istream& is, const std::vector<std::string>& names) {
+        const size_t old_size = size();
+        std::vector<detail::ingest_field> fields = 
+            detail::get_ingest_fields(*this,0,names);
+        size_t record_size = 0;
+        for (size_t k=0; k<fields.size(); ++k) {
+            CHECK(fields[k].parse,"insert_raw: "<<names[k]<<" is not a variable");
+            record_size += fields[k].size;
+        }
+
+        const std::streampos start = is.tellg();
+        is.seekg(0,std::ios::end);
+        const std::streampos end = is.tellg();
+        is.seekg(start);
+        CHECK(start >= 0 && end >= start,"insert_raw requires a seekable stream");
+        const size_t n = (end-start)/record_size;
+        CHECK(n*record_size == size_t(end-start),"insert_raw: stream length is not a multiple of the record size "<<record_size);
+        LOG(2,"insert_raw: reading "<<n<<" particles");
+
+        // the columns might have moved when they were resized
+        traits_type::resize(data,old_size+n);
+        fields = detail::get_ingest_fields(*this,old_size,names);
+
+        const size_t block_size = std::max(size_t(1),(size_t(1) << 20)/record_size);
+        std::vector<char> buffer(block_size*record_size);
+        for (size_t block_start=0; block_start<n; block_start+=block_size) {
+            const size_t count = std::min(block_size,n-block_start);
+            is.read(buffer.data(),count*record_size);
+            CHECK(is,"insert_raw: error reading stream");
+            #pragma omp parallel for
+            for (size_t i=0; i<count; ++i) {
+                const char* record = buffer.data() + i*record_size;
+                for (size_t k=0; k<fields.size(); ++k) {
+                    std::memcpy(fields[k].data+(block_start+i)*fields[k].stride,
+                                record,fields[k].size);
+                    record += fields[k].size;
+                }
+            }
+        }
+        embed_new_particles(old_size);
+    }
+
+    /// append the particles read from the raw binary records in the file 
+    /// \p filename
+    /// \see insert_raw(std::istream&,const std::vector<std::string>&)
+    void insert_raw(const std::string& filename, const std::vector<std::string>& names) {
+        std::ifstream is(filename,std::ios::binary);
+        CHECK(is,"could not open "<<filename<<" for reading");
+        insert_raw(is,names);
+    }
+
 #ifdef HAVE_VTK
     
     /// get a vtk unstructured grid version of the particle container
@@ -599,6 +1073,77 @@ public:
         return cache_grid;
     }
 
+    /// get a vtk unstructured grid that refers to the particle data rather
+    /// than copying it. 
+    ///
+    /// Each arithmetic or Vector variable becomes a point data array that 
+    /// wraps the variable's column directly, so calling this function 
+    /// costs O(1) per variable rather than a copy of every particle. 
+    /// The positions are also wrapped directly if the dimension is 3 (VTK 
+    /// points always have three components), otherwise they are copied. 
+    /// The vertex cells only depend on the number of particles and are only 
+    /// rebuilt when this changes. 
+    ///
+    /// The grid is cached internally and is only valid until the particle 
+    /// data is next reallocated (e.g. by push_back() or 
+    /// update_positions()), so call this function again before each use.
+    /// The random generator variable is not exported.
+    /// \see get_grid()
+    vtkSmartPointer<vtkUnstructuredGrid> get_grid_view() {
+        if (!cache_grid_view) {
+            cache_grid_view = vtkSmartPointer<vtkUnstructuredGrid>::New();
+            cache_grid_view_size = -1;
+        }
+        const vtkIdType n = size();
+
+        if (n != cache_grid_view_size) {
+            vtkSmartPointer<vtkIdTypeArray> connectivity = 
+                vtkSmartPointer<vtkIdTypeArray>::New();
+            connectivity->SetNumberOfValues(2*n);
+            for (vtkIdType i=0; i<n; ++i) {
+                connectivity->SetValue(2*i,1);
+                connectivity->SetValue(2*i+1,i);
+            }
+            vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+            cells->SetCells(n,connectivity);
+            cache_grid_view->SetCells(VTK_VERTEX,cells);
+            cache_grid_view_size = n;
+        }
+
+        const particles_type& const_this = *this;
+        typedef typename position::value_type::value_type position_element_type;
+        vtkSmartPointer<vtkAOSDataArrayTemplate<position_element_type>> point_array = 
+            vtkSmartPointer<vtkAOSDataArrayTemplate<position_element_type>>::New();
+        point_array->SetNumberOfComponents(3);
+        if (D == 3) {
+            point_array->SetArray(
+                const_cast<position_element_type*>(
+                    reinterpret_cast<const position_element_type*>(
+                        Aboria::get<position>(const_this).data())),
+                3*n,1);
+        } else {
+            point_array->SetNumberOfTuples(n);
+            const unsigned int max_d = std::min(3u,D);
+            #pragma omp parallel for
+            for (size_t i=0; i<n; ++i) {
+                const double_d& r = Aboria::get<position>(const_this)[i];
+                for (int d=0; d<3; ++d) {
+                    point_array->SetTypedComponent(i,d,d < max_d ? r[d] : 0);
+                }
+            }
+        }
+        vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+        points->SetData(point_array);
+        cache_grid_view->SetPoints(points);
+
+        mpl::for_each<mpl::range_c<int,1,mpl::size<mpl_type_vector>::type::value>> (
+                detail::wrap_columns_in_vtk_arrays<particles_type>(
+                    const_this,cache_grid_view->GetPointData())
+                );
+        cache_grid_view->Modified();
+        return cache_grid_view;
+    }
+
     ///  copy the particle data to a VTK unstructured grid
     void  copy_to_vtk_grid(vtkUnstructuredGrid *grid) {
         vtkSmartPointer<vtkPoints> points = grid->GetPoints();
@@ -674,10 +1219,11 @@ public:
                     );
 
             this->clear();
+            traits_type::resize(data,n);
 
             const unsigned int max_d = std::min(3u,traits_type::dimension);
             for (int j = 0; j < n; ++j) {
-                value_type particle;
+                reference particle = (*this)[j];
                 const double *r = points->GetPoint(j);
                 for (int d=0; d<max_d; ++d) {
                     get<position>(particle)[d] = r[d];
@@ -685,8 +1231,8 @@ public:
                 mpl::for_each<mpl::range_c<int,1,dn> > (
                         detail::read_into_tuple<reference>(particle.get_tuple(),j,datas)
                         );
-                this->push_back(particle);
             }
+            embed_new_particles(0);
         }
 #endif
 
@@ -703,29 +1249,248 @@ private:
     /// the container (default = true)
     void enforce_domain(const double_d& low, const double_d& high, const bool_d& periodic, const bool remove_deleted_particles = true) {
         LOG(2,"Particle: enforce_domain: low = "<<low<<" high = "<<high<<" periodic = "<<periodic<<" remove_deleted_particles = "<<remove_deleted_particles);
+        mark_all_dirty();
         
         detail::for_each(begin(), end(),
-                detail::enforce_domain_impl<traits_type::dimension,reference>(low,high,periodic));
+                detail::enforce_domain_impl<traits_type::dimension,reference,position>(low,high,periodic));
 
         if (remove_deleted_particles && (periodic==false).any()) {
             delete_particles();
         }
         if (remove_deleted_particles || (periodic==true).any()) {
-            search.embed_points(begin(),end());
+            embed_all_points();
+            if (!search.unordered()) update_id_to_index();
+        }
+    }
+
+    /// parse the complete lines in the first \p end characters of \p text
+    /// (see insert_csv()) and append them to the variables, without setting
+    /// up ids or the neighbourhood search. The text is split into blocks of
+    /// lines that are parsed in parallel
+    void insert_csv_lines(const std::string& text, const size_t end, 
+                          const std::vector<std::string>& names, 
+                          const char delimiter) {
+        // split the text into blocks that start at the beginning of a line
+        const size_t block_size = 1 << 16;
+        const size_t nblocks = end/block_size + 1;
+        std::vector<size_t> block_begin(nblocks+1,end);
+        block_begin[0] = 0;
+        for (size_t b=1; b<nblocks; ++b) {
+            const size_t newline = text.find('\n',b*block_size);
+            block_begin[b] = newline >= end ? end : newline+1;
+        }
+
+        // count the (non-empty) lines in each block
+        auto is_empty_line = [&](size_t begin, size_t end) {
+            return text.find_first_not_of(" \t\r",begin) >= end;
+        };
+        std::vector<size_t> block_rows(nblocks+1,0);
+        #pragma omp parallel for
+        for (size_t b=0; b<nblocks; ++b) {
+            size_t begin = block_begin[b];
+            while (begin < block_begin[b+1]) {
+                const size_t line_end = std::min(text.find('\n',begin),block_begin[b+1]);
+                if (!is_empty_line(begin,line_end)) ++block_rows[b+1];
+                begin = line_end+1;
+            }
+        }
+        for (size_t b=0; b<nblocks; ++b) {
+            block_rows[b+1] += block_rows[b];
+        }
+        if (block_rows[nblocks] == 0) return;
+
+        // the columns might have moved when they were resized
+        const size_t old_size = size();
+        traits_type::resize(data,old_size+block_rows[nblocks]);
+        const std::vector<detail::ingest_field> fields = 
+            detail::get_ingest_fields(*this,old_size,names);
+
+        #pragma omp parallel for
+        for (size_t b=0; b<nblocks; ++b) {
+            size_t row = block_rows[b];
+            size_t begin = block_begin[b];
+            while (begin < block_begin[b+1]) {
+                const size_t line_end = std::min(text.find('\n',begin),block_begin[b+1]);
+                if (!is_empty_line(begin,line_end)) {
+                    size_t field_begin = begin;
+                    for (size_t k=0; k<fields.size() && field_begin<line_end; ++k) {
+                        if (fields[k].parse) {
+                            fields[k].parse(text.data()+field_begin,
+                                            fields[k].data+row*fields[k].stride);
+                        }
+                        field_begin = std::min(text.find(delimiter,field_begin),line_end)+1;
+                    }
+                    ++row;
+                }
+                begin = line_end+1;
+            }
+        }
+    }
+
+    /// initialise the particles from index \p old_size to the end of the 
+    /// container after they have been appended in bulk. Sets alive, removes 
+    /// any particles outside the search domain, assigns ids and random seeds
+    /// and adds the new particles to the neighbourhood search
+    void embed_new_particles(const size_t old_size) {
+        mark_all_dirty();
+        const size_t n = size();
+        if (searchable) {
+            detail::enforce_domain_impl<traits_type::dimension,reference,position> 
+                enforcer(search.get_min(),search.get_max(),search.get_periodic());
+            #pragma omp parallel for
+            for (size_t i=old_size; i<n; ++i) {
+                Aboria::get<alive>(data)[i] = true;
+                enforcer((*this)[i]);
+            }
+
+            // remove new particles that are outside the domain, keeping 
+            // the order of the rest
+            size_t n_alive = old_size;
+            for (size_t i=old_size; i<n; ++i) {
+                if (Aboria::get<alive>(data)[i]) {
+                    if (i != n_alive) {
+                        (*this)[n_alive] = (*this)[i];
+                    }
+                    ++n_alive;
+                } else {
+                    LOG(2,"WARNING: particle you tried to push back with r = "<<Aboria::get<position>(data)[i]<<" is outside the domain and has been removed");
+                }
+            }
+            traits_type::resize(data,n_alive);
+        } else {
+            #pragma omp parallel for
+            for (size_t i=old_size; i<n; ++i) {
+                Aboria::get<alive>(data)[i] = true;
+            }
+        }
+
+        const size_t n_new = size()-old_size;
+        #pragma omp parallel for
+        for (size_t i=0; i<n_new; ++i) {
+            Aboria::get<id>(data)[old_size+i] = next_id + i;
+            Aboria::get<random>(data)[old_size+i].seed(
+                    seed + uint32_t(next_id + i)
+                );
+        }
+        next_id += n_new;
+
+        if (searchable) {
+            search.add_points_at_end(begin(),begin()+old_size,end());
+            if (!search.unordered()) {
+                update_id_to_index();
+                return;
+            }
+        }
+        update_id_to_index(old_size);
+    }
+
+    detail::checkpoint_header<dimension> read_checkpoint_header(std::istream& is) const {
+        detail::checkpoint_header<dimension> header;
+        header.read(is);
+        CHECK(header.dimension == dimension,"checkpoint has dimension "<<header.dimension<<" != "<<dimension);
+        CHECK(header.ncolumns == mpl::size<mpl_type_vector>::type::value,"checkpoint has "<<header.ncolumns<<" variables, expected "<<mpl::size<mpl_type_vector>::type::value);
+        return header;
+    }
+
+    /// reorder the particles within each bucket of an (ordered) 
+    /// neighbourhood search, so that they are sorted by \p order, which is 
+    /// indexed by particle id. The buckets, and so the search, are unchanged
+    void restore_order_within_buckets(const std::vector<size_t>& order) {
+        const size_t n = size();
+        const query_type& query = search.get_query();
+        const auto& positions = Aboria::get<position>(data);
+        const auto& ids = Aboria::get<id>(data);
+        std::vector<size_t> permutation(n);
+        for (size_t i=0; i<n; ++i) {
+            permutation[i] = i;
+        }
+        bool reordered = false;
+        for (size_t start=0; start<n; ) {
+            const auto bucket = query.get_bucket(positions[start]);
+            size_t end = start+1;
+            while (end < n && (query.get_bucket(positions[end]) == bucket).all()) {
+                ++end;
+            }
+            std::sort(permutation.begin()+start,permutation.begin()+end,
+                    [&](const size_t a, const size_t b) { 
+                        return order[ids[a]] < order[ids[b]]; 
+                    });
+            for (size_t i=start; i<end; ++i) {
+                reordered |= permutation[i] != i;
+            }
+            start = end;
+        }
+        if (!reordered) return;
+
+        const data_type copy(data);
+        #pragma omp parallel for
+        for (size_t i=0; i<n; ++i) {
+            (*this)[i] = traits_type::index(copy,permutation[i]);
+        }
+    }
+
+    /// (re)build the neighbourhood search for all the particles
+    void embed_all_points() {
+        search.embed_points(begin(),end());
+        search_incomplete = false;
+    }
+
+    /// after copying \p data and \p search from another container, the 
+    /// search still refers to the other container's particles. The copied
+    /// particles are in the same order, so only the iterators need 
+    /// updating and the copied id lookup table stays valid, unless the 
+    /// other search was only partially embedded
+    void rebuild_search_after_copy() {
+        if (!searchable) return;
+        if (search_incomplete) {
+            embed_all_points();
+            update_id_to_index();
+        } else {
+            search.update_iterators(begin(),end());
+        }
+    }
+
+    /// update the id to index lookup table used by find() for the particles 
+    /// from index \p start to the end of the container. The table is indexed 
+    /// by id, so entries for deleted particles are left stale and are 
+    /// detected in find() by comparing the id stored at the looked-up index
+    void update_id_to_index(const size_t start = 0) {
+        id_to_index.resize(next_id);
+        const size_t n = size();
+        #pragma omp parallel for
+        for (size_t i=start; i<n; ++i) {
+            id_to_index[Aboria::get<id>(data)[i]] = i;
+        }
+    }
+
+    /// returns the index of the particle with id \p particle_id, or size()
+    /// if there is no such particle in the container
+    size_t find_index(const size_t particle_id) const {
+        if (particle_id < id_to_index.size()) {
+            const size_t index = id_to_index[particle_id];
+            if (index < size() && Aboria::get<id>(data)[index] == particle_id) {
+                return index;
+            }
         }
+        return size();
     }
 
 
     data_type data;
     bool searchable;
     int next_id;
-    const uint32_t seed;
-    std::map<size_t,size_t> id_to_index;
+    uint32_t seed;
+    typename traits_type::vector_size_t id_to_index;
     search_type search;
+    bool search_incomplete;
+    std::array<size_t,mpl::size<mpl_type_vector>::type::value> generation;
+    size_t structure_generation;
 
 
 #ifdef HAVE_VTK
     vtkSmartPointer<vtkUnstructuredGrid> cache_grid;
+    vtkSmartPointer<vtkUnstructuredGrid> cache_grid_view;
+    vtkIdType cache_grid_view_size;
 #endif
 };
 
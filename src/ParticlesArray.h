@@ -34,10 +34,22 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 
+
 #ifndef PARTICLESARRAY_H_
 #define PARTICLESARRAY_H_
 
+#include <tuple>
+#include <vector>
+#include <type_traits>
+#include <boost/range/iterator_range.hpp>
+#include <boost/range/join.hpp>
+
 #include "Particles.h"
+#include "NeighbourSearchBase.h"
+#include "detail/SpatialUtil.h"
+#include "Vector.h"
+#include "Get.h"
+#include "Log.h"
 
 namespace Aboria {
 
@@ -57,89 +69,366 @@ template<class C, class D, class... Args>
                                        join(std::forward<Args>(args)...));
     }
 
-template <typename T>
+namespace detail {
+
+/// an entry in the combined neighbourhood search of a ParticlesArray, 
+/// giving the species and the index of a particle within that species
+struct species_entry {
+    unsigned int species;
+    size_t index;
+};
+
+/// calls \p f with the species tag and a reference to particle \p index in 
+/// species \p s, converting the runtime species index to a compile time one
+template <unsigned int I, unsigned int N>
+struct species_dispatch {
+    template <typename Tuple, typename Function>
+    static void apply(Tuple& species, const unsigned int s, const size_t index, Function& f) {
+        if (s == I) {
+            f(std::integral_constant<unsigned int,I>(), std::get<I>(species)[index]);
+        } else {
+            species_dispatch<I+1,N>::apply(species,s,index,f);
+        }
+    }
+};
+
+template <unsigned int N>
+struct species_dispatch<N,N> {
+    template <typename Tuple, typename Function>
+    static void apply(Tuple&, const unsigned int s, const size_t, Function&) {
+        ASSERT(false,"species index "<<s<<" out of range");
+    }
+};
+
+template <typename Function, typename double_d>
+struct neighbour_visitor {
+    Function& m_f;
+    const double_d& m_dx;
+
+    template <typename Tag, typename Reference>
+    void operator()(Tag tag, Reference j) {
+        m_f(tag,j,m_dx);
+    }
+};
+
+template <typename TagI, typename ReferenceI, typename Function>
+struct pair_visitor_inner {
+    ReferenceI m_i;
+    Function& m_f;
+
+    template <typename TagJ, typename ReferenceJ, typename double_d>
+    void operator()(TagJ tag_j, ReferenceJ j, const double_d& dx) {
+        m_f(TagI(),m_i,tag_j,j,dx);
+    }
+};
+
+template <typename Array, typename Function>
+struct pair_visitor_outer {
+    typedef typename Array::double_d double_d;
+    Array& m_array;
+    Function& m_f;
+    const double_d& m_r;
+
+    template <typename Tag, typename Reference>
+    void operator()(Tag, Reference i) {
+        pair_visitor_inner<Tag,Reference,Function> inner{i,m_f};
+        m_array.for_each_neighbour(m_r,inner);
+    }
+};
+
+}
+
+/// \brief A container holding several species of particles, with a single 
+/// neighbourhood search over all of them
+///
+/// Each species is stored in its own Particles container, and so can have 
+/// its own set of variables. The array builds one regular grid over the 
+/// particles of every species, with each entry tagged by its species, so
+/// that interactions between all pairs of species can be found with a 
+/// single traversal and without each species keeping its own grid (the 
+/// species containers do not need their own neighbourhood search). 
+///
+/// Neighbours are passed to a user-supplied functor along with an 
+/// std::integral_constant tag giving the species, so that the functor can
+/// be overloaded for each species or pair of species.
+///
+/// The combined search stores a copy of the particle positions, so 
+/// update_neighbour_search() must be called after particles are added, 
+/// deleted or moved in any of the species.
+///
+///  \code 
+///     typedef Particles<std::tuple<scalar>> Solvent;
+///     typedef Particles<std::tuple<charge>> Ions;
+///     ParticlesArray<Solvent,Ions> mixture;
+///     mixture.get_species<0>().push_back(...);
+///     mixture.get_species<1>().push_back(...);
+///     mixture.init_neighbour_search(min,max,diameter,periodic);
+///     mixture.for_each_pair(my_kernel());
+///  \endcode
+///
+///  \param ParticlesTypes the Particles type of each species
+template <typename... ParticlesTypes>
 class ParticlesArray {
+    typedef std::tuple<ParticlesTypes...> species_tuple_type;
+    typedef typename std::tuple_element<0,species_tuple_type>::type first_species_type;
+
 public:
-    typedef typename T::value_type value_type;
-    typedef typename T::iterator set_iterator;
-    typedef typename T::const_iterator const_set_iterator;
-
-    ParticlesArray(std::initializer_list<T> sets): sets(sets) {}
-
-
-    template <class Value>
-    class node_iter
-        : public boost::iterator_facade<
-            node_iter<Value>
-            , Value
-            , boost::forward_traversal_tag
-          >
-    {
-    public:
-        node_iter()
-            : m_node(0),set_index(0) {}
-
-        explicit node_iter(Value* p)
-            : m_node(p) {}
-
-        template <class OtherValue>
-        node_iter(
-            node_iter<OtherValue> const& other
-            , typename boost::enable_if<
-                boost::is_convertible<OtherValue*,Value*>
-                , enabler
-              >::type = enabler()
-        )
-            : m_node(other.m_node) {}
-
-    private:
-        friend class boost::iterator_core_access;
-        template <class> friend class node_iter;
-
-        template <class OtherValue>
-        bool equal(node_iter<OtherValue> const& other) const
-        {
-            return this->m_node == other.m_node;
-        }
+    /// the number of species in the array
+    static const unsigned int number_of_species = sizeof...(ParticlesTypes);
 
-        void increment()
-        { m_node = m_node->next(); }
+    /// the number of spatial dimensions, this must be the same for all species
+    static const unsigned int dimension = first_species_type::dimension;
 
-        Value& dereference() const
-        { return *m_node; }
+    typedef Vector<double,dimension> double_d;
+    typedef Vector<bool,dimension> bool_d;
+    typedef Vector<int,dimension> int_d;
+    typedef Vector<unsigned int,dimension> unsigned_int_d;
 
-        Value m_set_iterator;
-        int set_index;
+    /// the Particles type of species \p I
+    template <unsigned int I>
+    struct species_type {
+        typedef typename std::tuple_element<I,species_tuple_type>::type type;
     };
-    typedef impl::node_iterator<set_iterator> iterator;
-    typedef impl::node_iterator<const_set_iterator> const_iterator;
 
+    /// the tag passed to the neighbour functors for species \p I
+    template <unsigned int I>
+    struct species_tag {
+        typedef std::integral_constant<unsigned int,I> type;
+    };
 
-    boost::iterator_range<typename NeighbourSearch_type::const_iterator> get_neighbours(const Vect3d position) {
-        ASSERT(searchable == true,"ERROR: using get_neighbours before initialising neighbour search. Please call the init_neighbour_search function before using get_neighbours");
-        return boost::make_iterator_range(
-                neighbour_search.find_broadphase_neighbours(position, -1,false),
-                neighbour_search.end());
+    ParticlesArray():
+        m_searchable(false)
+    {}
 
-    iterator begin() {
-        return data.begin();
+    /// returns the container holding species \p I
+    template <unsigned int I>
+    typename species_type<I>::type& get_species() {
+        return std::get<I>(m_species);
     }
-    iterator end() {
-        return data.end();
+
+    /// returns the container holding species \p I
+    template <unsigned int I>
+    const typename species_type<I>::type& get_species() const {
+        return std::get<I>(m_species);
     }
 
+    /// returns the total number of particles over all species
+    size_t size() const {
+        return size_impl(std::integral_constant<unsigned int,0>());
+    }
 
+    /// initialise the combined neighbourhood search over all the species,
+    /// using a regular grid over the domain \p low to \p high with buckets 
+    /// of side length \p length_scale and periodicity \p periodic. 
+    /// All particles must lie within the domain, i.e. low <= r < high, 
+    /// which is checked whenever the search is rebuilt. Use 
+    /// Particles::enforce_domain() on each species to wrap or remove 
+    /// particles that have left it
+    void init_neighbour_search(const double_d& low, const double_d& high, 
+                               const double length_scale, 
+                               const bool_d& periodic) {
+        LOG(2,"ParticlesArray: init_neighbour_search: low = "<<low<<" high = "<<high<<" length_scale = "<<length_scale<<" periodic = "<<periodic);
+        m_bounds.bmin = low;
+        m_bounds.bmax = high;
+        m_periodic = periodic;
+        m_size = floor((high-low)/length_scale).template cast<unsigned int>();
+        for (size_t i=0; i<dimension; ++i) {
+            if (m_size[i] == 0) m_size[i] = 1;
+        }
+        m_bucket_side_length = (high-low)/m_size;
+        m_end_bucket = m_size-1;
+        m_point_to_bucket_index = 
+            detail::point_to_bucket_index<dimension>(m_size,m_bucket_side_length,m_bounds);
+	    LOG(2,"\tnumber of buckets = "<<m_size<<" (total="<<m_size.prod()<<")");
+        m_searchable = true;
+        update_neighbour_search();
     }
 
+    /// rebuild the combined neighbourhood search. This must be called after
+    /// particles are added, deleted or moved in any of the species
+    void update_neighbour_search() {
+        CHECK(m_searchable,"neighbourhood search not initialised, call init_neighbour_search() first");
+        const size_t n = size();
+        std::vector<detail::species_entry> entries(n);
+        std::vector<double_d> positions(n);
+        std::vector<unsigned int> buckets(n);
+        append_entries(std::integral_constant<unsigned int,0>(),0,
+                       entries,positions,buckets);
+
+        // counting sort of the entries by bucket index
+        const size_t nbuckets = m_size.prod();
+        m_bucket_begin.assign(nbuckets,0);
+        m_bucket_end.assign(nbuckets,0);
+        for (size_t i=0; i<n; ++i) {
+            ++m_bucket_end[buckets[i]];
+        }
+        unsigned int start = 0;
+        for (size_t i=0; i<nbuckets; ++i) {
+            m_bucket_begin[i] = start;
+            start += m_bucket_end[i];
+            m_bucket_end[i] = m_bucket_begin[i];
+        }
+        m_entries.resize(n);
+        m_positions.resize(n);
+        for (size_t i=0; i<n; ++i) {
+            const unsigned int j = m_bucket_end[buckets[i]]++;
+            m_entries[j] = entries[i];
+            m_positions[j] = positions[i];
+        }
+    }
 
-private:
+    /// calls \p f for every particle (of any species) within one bucket 
+    /// side length (in the infinity norm) of the point \p r, as 
+    ///
+    /// f(species_tag, reference, dx)
+    ///
+    /// where species_tag is an std::integral_constant giving the species of 
+    /// the particle, reference is a reference to the particle and dx is the
+    /// shortest vector from \p r to the particle, taking into account 
+    /// periodicity
+    template <typename Function>
+    void for_each_neighbour(const double_d& r, Function f) {
+        ASSERT(m_searchable,"neighbourhood search not initialised, call init_neighbour_search() first");
+        const int_d bucket = m_point_to_bucket_index.find_bucket_index_vector(r);
+        int_d start,end;
+        for (size_t i=0; i<dimension; i++) {
+            if (m_periodic[i]) {
+                start[i] = bucket[i]-1;
+                end[i] = bucket[i]+1;
+            } else {
+                start[i] = bucket[i] > 0 ? bucket[i]-1 : bucket[i];
+                end[i] = bucket[i] < m_end_bucket[i] ? bucket[i]+1 : bucket[i];
+            }
+        }
 
-    std::vector<T> sets;
-}
+        const lattice_iterator<dimension> buckets_end = 
+                    ++lattice_iterator<dimension>(start,end,end);
+        for (lattice_iterator<dimension> b(start,end,start); b != buckets_end; ++b) {
+            // handle end cases
+            int_d my_bucket(*b);
+            double_d transpose(0);
+            bool outside = false;
+            for (size_t i=0; i<dimension; i++) {
+                if ((*b)[i] < 0) {
+                    if (m_periodic[i]) {
+                        my_bucket[i] = m_end_bucket[i];
+                        transpose[i] = -(m_bounds.bmax-m_bounds.bmin)[i];
+                    } else {
+                        outside = true;
+                        break;
+                    }
+                }
+                if ((*b)[i] > m_end_bucket[i]) {
+                    if (m_periodic[i]) {
+                        my_bucket[i] = 0;
+                        transpose[i] = (m_bounds.bmax-m_bounds.bmin)[i];
+                    } else {
+                        outside = true;
+                        break;
+                    }
+                }
+            }
+            if (outside) continue;
+
+            const unsigned int bucket_index = 
+                m_point_to_bucket_index.collapse_index_vector(my_bucket);
+            for (unsigned int j = m_bucket_begin[bucket_index]; 
+                    j < m_bucket_end[bucket_index]; ++j) {
+                const double_d dx = m_positions[j] + transpose - r;
+                if ((abs(dx) <= m_bucket_side_length).all()) {
+                    detail::neighbour_visitor<Function,double_d> visitor{f,dx};
+                    detail::species_dispatch<0,number_of_species>::apply(
+                            m_species,m_entries[j].species,m_entries[j].index,visitor);
+                }
+            }
+        }
+    }
 
+    /// calls \p f for every pair of neighbouring particles i and j (of any 
+    /// species), using a single traversal of the combined search, as
+    ///
+    /// f(species_tag_i, reference_i, species_tag_j, reference_j, dx)
+    ///
+    /// where dx is the shortest vector from i to j. Each pair is visited 
+    /// in both orders, and each particle is paired with itself. The particles
+    /// i are visited in parallel, so \p f should only alter the particle i
+    template <typename Function>
+    void for_each_pair(Function f) {
+        CHECK(m_searchable,"neighbourhood search not initialised, call init_neighbour_search() first");
+        const size_t n = m_entries.size();
+        #pragma omp parallel for
+        for (size_t i=0; i<n; ++i) {
+            detail::pair_visitor_outer<ParticlesArray,Function> visitor{*this,f,m_positions[i]};
+            detail::species_dispatch<0,number_of_species>::apply(
+                    m_species,m_entries[i].species,m_entries[i].index,visitor);
+        }
+    }
 
-}
+    /// return the lower extent of the combined neighbourhood search
+    const double_d& get_min() const { return m_bounds.bmin; }
 
-#endif PARTICLESARRAY_H_
+    /// return the upper extent of the combined neighbourhood search
+    const double_d& get_max() const { return m_bounds.bmax; }
 
+    /// return the periodicty of the combined neighbourhood search
+    const bool_d& get_periodic() const { return m_periodic; }
+
+private:
+    template <unsigned int I>
+    size_t size_impl(std::integral_constant<unsigned int,I>) const {
+        return std::get<I>(m_species).size() 
+            + size_impl(std::integral_constant<unsigned int,I+1>());
+    }
+
+    size_t size_impl(std::integral_constant<unsigned int,number_of_species>) const {
+        return 0;
+    }
+
+    template <unsigned int I>
+    void append_entries(std::integral_constant<unsigned int,I>, const size_t offset,
+                        std::vector<detail::species_entry>& entries,
+                        std::vector<double_d>& positions,
+                        std::vector<unsigned int>& buckets) const {
+        typedef typename species_type<I>::type particles_type;
+        typedef typename particles_type::position position;
+        static_assert(particles_type::dimension == dimension,
+                "all species must have the same number of spatial dimensions");
+
+        const particles_type& particles = std::get<I>(m_species);
+        const size_t n = particles.size();
+        #pragma omp parallel for
+        for (size_t i=0; i<n; ++i) {
+            const double_d r = get<position>(particles[i]);
+            CHECK((r >= m_bounds.bmin).all() && (r < m_bounds.bmax).all(),
+                  "particle at r = "<<r<<" of species "<<I<<" is outside the neighbourhood search domain");
+            entries[offset+i].species = I;
+            entries[offset+i].index = i;
+            positions[offset+i] = r;
+            buckets[offset+i] = m_point_to_bucket_index(r);
+        }
+        append_entries(std::integral_constant<unsigned int,I+1>(),offset+n,
+                       entries,positions,buckets);
+    }
+
+    void append_entries(std::integral_constant<unsigned int,number_of_species>, const size_t,
+                        std::vector<detail::species_entry>&,
+                        std::vector<double_d>&,
+                        std::vector<unsigned int>&) const {}
+
+    species_tuple_type m_species;
+    bool m_searchable;
+    detail::bbox<dimension> m_bounds;
+    bool_d m_periodic;
+    unsigned_int_d m_size;
+    int_d m_end_bucket;
+    double_d m_bucket_side_length;
+    detail::point_to_bucket_index<dimension> m_point_to_bucket_index;
+    std::vector<unsigned int> m_bucket_begin;
+    std::vector<unsigned int> m_bucket_end;
+    std::vector<detail::species_entry> m_entries;
+    std::vector<double_d> m_positions;
+};
+
+}
 
+#endif /* PARTICLESARRAY_H_ */
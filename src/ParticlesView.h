@@ -0,0 +1,472 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef PARTICLES_VIEW_H_
+#define PARTICLES_VIEW_H_
+
+#include <vector>
+#include <algorithm>
+#include <boost/iterator/permutation_iterator.hpp>
+
+#include "BucketSearchParallel.h"
+#include "NeighbourSearchBase.h"
+#include "CudaInclude.h"
+#include "Vector.h"
+#include "Get.h"
+#include "Log.h"
+
+namespace Aboria {
+
+/// A const iterator over a subset of the particles in a container, given by
+/// a list of indices. This iterator implements a STL forward iterator type
+template <typename Traits>
+class subset_iterator {
+    typedef typename Traits::raw_reference p_reference;
+    typedef typename Traits::raw_pointer p_pointer;
+
+public:
+    typedef Traits traits_type;
+    typedef const p_pointer pointer;
+	typedef std::forward_iterator_tag iterator_category;
+    typedef const p_reference reference;
+    typedef const p_reference value_type;
+	typedef std::ptrdiff_t difference_type;
+
+    CUDA_HOST_DEVICE
+    subset_iterator() {}
+
+    CUDA_HOST_DEVICE
+    subset_iterator(const p_pointer& begin, const size_t* index):
+        m_begin(begin),
+        m_current_index(index)
+    {}
+
+    CUDA_HOST_DEVICE
+    reference operator *() const {
+        return dereference();
+    }
+
+    CUDA_HOST_DEVICE
+    reference operator ->() const {
+        return dereference();
+    }
+
+    CUDA_HOST_DEVICE
+    subset_iterator& operator++() {
+        increment();
+        return *this;
+    }
+
+    CUDA_HOST_DEVICE
+    subset_iterator operator++(int) {
+        subset_iterator tmp(*this);
+        operator++();
+        return tmp;
+    }
+
+    CUDA_HOST_DEVICE
+    size_t operator-(subset_iterator start) const {
+        return m_current_index - start.m_current_index;
+    }
+
+    CUDA_HOST_DEVICE
+    inline bool operator==(const subset_iterator& rhs) const {
+        return equal(rhs);
+    }
+
+    CUDA_HOST_DEVICE
+    inline bool operator!=(const subset_iterator& rhs) const {
+        return !operator==(rhs);
+    }
+
+private:
+    CUDA_HOST_DEVICE
+    bool equal(subset_iterator const& other) const {
+        return m_current_index == other.m_current_index;
+    }
+
+    CUDA_HOST_DEVICE
+    reference dereference() const { 
+        return *(m_begin + *m_current_index); 
+    }
+
+    CUDA_HOST_DEVICE
+    void increment() {
+        ++m_current_index;
+    }
+
+    p_pointer m_begin;
+    const size_t* m_current_index;
+};
+
+/// query object for the neighbourhood search over a ParticlesView. This uses 
+/// the same regular grid as bucket_search_parallel_query, but each bucket 
+/// holds a range of indices into the parent container rather than a range 
+/// of particles
+template <typename Traits>
+struct subset_search_query: public bucket_search_parallel_query<Traits> {
+    typedef bucket_search_parallel_query<Traits> base_type;
+    typedef typename base_type::double_d double_d;
+    typedef typename base_type::int_d int_d;
+    typedef typename base_type::bucket_reference bucket_reference;
+    typedef subset_iterator<Traits> particle_iterator;
+
+    const size_t *m_indices;
+
+    inline
+    CUDA_HOST_DEVICE
+    subset_search_query():
+        base_type(),
+        m_indices()
+    {}
+
+    CUDA_HOST_DEVICE
+    iterator_range_with_transpose<particle_iterator> get_bucket_particles(const bucket_reference &bucket) const {
+        int_d my_bucket(bucket);
+        // handle end cases
+        double_d transpose(0);
+        bool outside = false;
+        for (size_t i=0; i<Traits::dimension; i++) {
+            if (bucket[i] < 0) {
+                if (this->m_periodic[i]) {
+                    my_bucket[i] = this->m_end_bucket[i];
+                    transpose[i] = -(this->m_bounds.bmax-this->m_bounds.bmin)[i];
+                } else {
+                    outside = true;
+                    break;
+                }
+            }
+            if (bucket[i] > this->m_end_bucket[i]) {
+                if (this->m_periodic[i]) {
+                    my_bucket[i] = 0;
+                    transpose[i] = (this->m_bounds.bmax-this->m_bounds.bmin)[i];
+                } else {
+                    outside = true;
+                    break;
+                }
+            }
+        }
+
+        if (!outside) {
+            const unsigned int bucket_index = this->m_point_to_bucket_index.collapse_index_vector(my_bucket);
+            return iterator_range_with_transpose<particle_iterator>(
+                    particle_iterator(this->m_particles_begin, 
+                                      m_indices + this->m_bucket_begin[bucket_index]),
+                    particle_iterator(this->m_particles_begin, 
+                                      m_indices + this->m_bucket_end[bucket_index]),
+                    transpose);
+        } else {
+            return iterator_range_with_transpose<particle_iterator>(
+                    particle_iterator(this->m_particles_begin,m_indices),
+                    particle_iterator(this->m_particles_begin,m_indices)
+                    );
+        }
+    }
+};
+
+/// \brief A non-owning view of a subset of the particles in a Particles 
+/// container
+///
+/// The view holds a list of indices into the parent container, and can be 
+/// used with Label and the symbolic sums in the same way as a Particles 
+/// container, so an expression evaluated over the view only visits the 
+/// particles in the subset. The view can optionally build its own 
+/// neighbourhood search containing only the subset particles.
+///
+/// The indices are invalidated if the parent container is reordered (e.g. by
+/// adding or deleting particles). Call update() to recover the indices from
+/// the ids of the particles in the view.
+///
+///  \code 
+///     typedef Particles<std::tuple<scalar>> MyParticles;
+///     MyParticles particles;
+///     ...
+///     ParticlesView<MyParticles> boundary(particles, 
+///         [](MyParticles::const_reference i) { 
+///             return get<position>(i)[0] < 0.1; 
+///         });
+///     Label<0,ParticlesView<MyParticles>> a(boundary);
+///     s[a] = 0;
+///  \endcode
+///
+///  \param ParticlesType the type of the parent Particles container
+template <typename ParticlesType>
+class ParticlesView {
+public:
+    /// the type of the parent container
+    typedef ParticlesType parent_type;
+    typedef typename ParticlesType::traits_type traits_type;
+    typedef typename ParticlesType::value_type value_type;
+    typedef typename ParticlesType::reference reference;
+    typedef typename ParticlesType::const_reference const_reference;
+    typedef typename ParticlesType::data_type data_type;
+    typedef typename ParticlesType::size_type size_type;
+    typedef typename ParticlesType::mpl_type_vector mpl_type_vector;
+    typedef typename ParticlesType::position position;
+    typedef typename ParticlesType::double_d double_d;
+    typedef typename ParticlesType::bool_d bool_d;
+    static const unsigned int dimension = ParticlesType::dimension;
+
+    /// the query class for the subset-only neighbourhood search
+    typedef subset_search_query<traits_type> query_type;
+
+    /// iterator over the particles in the view
+    typedef boost::permutation_iterator<
+                typename ParticlesType::iterator,
+                typename std::vector<size_t>::const_iterator> iterator;
+
+    /// constructs an empty view of \p parent
+    ParticlesView(ParticlesType& parent):
+        m_parent(&parent),
+        m_searchable(false)
+    {}
+
+    /// constructs a view of all the particles in \p parent for which 
+    /// \p predicate returns true
+    template <typename Predicate>
+    ParticlesView(ParticlesType& parent, Predicate predicate):
+        m_parent(&parent),
+        m_searchable(false)
+    {
+        const size_t n = parent.size();
+        for (size_t i=0; i<n; ++i) {
+            if (predicate(static_cast<const ParticlesType&>(parent)[i])) {
+                push_back(i);
+            }
+        }
+    }
+
+    /// copy-constructor. The new view refers to the same parent container
+    ParticlesView(const ParticlesView& other):
+        m_parent(other.m_parent),
+        m_indices(other.m_indices),
+        m_ids(other.m_ids),
+        m_searchable(other.m_searchable),
+        m_size(other.m_size),
+        m_query(other.m_query)
+    {
+        if (m_searchable) update_search();
+    }
+
+    ParticlesView& operator=(const ParticlesView& other) = delete;
+
+    /// add the particle with index \p index in the parent container to the
+    /// view. Note that this does not update the neighbourhood search
+    void push_back(const size_t index) {
+        ASSERT(index < m_parent->size(),"index larger than parent container");
+        m_indices.push_back(index);
+        m_ids.push_back(get<id>((*m_parent)[index]));
+    }
+
+    /// removes all the particles from the view
+    void clear() {
+        m_indices.clear();
+        m_ids.clear();
+        if (m_searchable) update_search();
+    }
+
+    /// returns the number of particles in the view
+    size_t size() const {
+        return m_indices.size();
+    }
+
+    /// returns a reference to the particle at position \p idx in the view
+    reference operator[](std::size_t idx) {
+        return (*m_parent)[m_indices[idx]];
+    }
+
+    /// returns a const_reference to the particle at position \p idx in the view
+    const_reference operator[](std::size_t idx) const {
+        return static_cast<const ParticlesType&>(*m_parent)[m_indices[idx]];
+    }
+
+    /// returns an iterator to the beginning of the view
+    iterator begin() {
+        return iterator(m_parent->begin(),m_indices.cbegin());
+    }
+
+    /// returns an iterator to the end of the view
+    iterator end() {
+        return iterator(m_parent->begin(),m_indices.cend());
+    }
+
+    /// returns the indices of the particles in the parent container
+    const std::vector<size_t>& get_indices() const {
+        return m_indices;
+    }
+
+    /// returns the parent container
+    ParticlesType& get_parent() const {
+        return *m_parent;
+    }
+
+    /// initialise a neighbourhood search containing only the particles in 
+    /// the view. The search uses the domain and periodicity of the parent 
+    /// container's search, which must already be initialised, and buckets 
+    /// of side length \p length_scale. 
+    /// Note: this sorts the view by bucket index
+    void init_neighbour_search(const double length_scale) {
+        m_size = floor((get_max()-get_min())/length_scale)
+                    .template cast<unsigned int>();
+        for (size_t i=0; i<dimension; ++i) {
+            if (m_size[i] == 0) m_size[i] = 1;
+        }
+        m_query.m_bucket_side_length = (get_max()-get_min())/m_size;
+        m_query.m_bounds.bmin = get_min();
+        m_query.m_bounds.bmax = get_max();
+        m_query.m_periodic = get_periodic();
+        m_query.m_end_bucket = m_size-1;
+        m_query.m_point_to_bucket_index = 
+            detail::point_to_bucket_index<dimension>(m_size,
+                                                     m_query.m_bucket_side_length,
+                                                     m_query.m_bounds);
+        m_searchable = true;
+        update_search();
+    }
+
+    const query_type& get_query() const {
+        CHECK(m_searchable,"neighbourhood search not initialised, call init_neighbour_search() first");
+        return m_query;
+    }
+
+    /// return the lower extent of the parent neighbourhood search
+    const double_d& get_min() const { return m_parent->get_min(); }
+
+    /// return the upper extent of the parent neighbourhood search
+    const double_d& get_max() const { return m_parent->get_max(); }
+
+    /// return the periodicty of the parent neighbourhood search
+    const bool_d& get_periodic() const { return m_parent->get_periodic(); }
+
+    /// update the indices of the particles in the view using their ids. This
+    /// must be called after the parent container has been reordered. Any 
+    /// particles that have been deleted from the parent are removed from 
+    /// the view, and the neighbourhood search (if on) is rebuilt
+    void update() {
+        size_t n = 0;
+        for (size_t i=0; i<m_ids.size(); ++i) {
+            auto it = m_parent->find(m_ids[i]);
+            if (it != m_parent->end()) {
+                m_indices[n] = it - m_parent->begin();
+                m_ids[n] = m_ids[i];
+                ++n;
+            }
+        }
+        m_indices.resize(n);
+        m_ids.resize(n);
+        if (m_searchable) update_search();
+    }
+
+    /// update the parent container after the positions of the particles 
+    /// in the view have been altered, and then update() the view
+    void update_positions() {
+        m_parent->update_positions();
+        update();
+    }
+
+    /// delete the particles in the parent container with alive==false, and 
+    /// then update() the view
+    void delete_particles() {
+        m_parent->delete_particles();
+        update();
+    }
+
+    /// record that variable \p T of the parent container has changed
+    /// \see Particles::mark_dirty()
+    template <typename T>
+    void mark_dirty() {
+        m_parent->template mark_dirty<T>();
+    }
+
+private:
+    
+    /// sort the view by bucket and rebuild the bucket ranges 
+    void update_search() {
+        const size_t n = m_indices.size();
+        std::vector<std::pair<unsigned int,size_t>> bucket_and_index(n);
+        for (size_t i=0; i<n; ++i) {
+            bucket_and_index[i].first = m_query.m_point_to_bucket_index(
+                                get<position>((*m_parent)[m_indices[i]]));
+            bucket_and_index[i].second = i;
+        }
+        std::stable_sort(bucket_and_index.begin(),bucket_and_index.end(),
+                [](const std::pair<unsigned int,size_t>& a, 
+                   const std::pair<unsigned int,size_t>& b) {
+                    return a.first < b.first;
+                });
+
+        std::vector<size_t> old_indices(m_indices), old_ids(m_ids);
+        const size_t nbuckets = m_size.prod();
+        m_bucket_begin.assign(nbuckets,0);
+        m_bucket_end.assign(nbuckets,0);
+        for (size_t i=0; i<n; ++i) {
+            const unsigned int bucket = bucket_and_index[i].first;
+            m_indices[i] = old_indices[bucket_and_index[i].second];
+            m_ids[i] = old_ids[bucket_and_index[i].second];
+            if (i == 0 || bucket_and_index[i-1].first != bucket) {
+                m_bucket_begin[bucket] = i;
+            }
+            m_bucket_end[bucket] = i+1;
+        }
+
+        m_query.m_particles_begin = iterator_to_raw_pointer(m_parent->begin());
+        m_query.m_particles_end = iterator_to_raw_pointer(m_parent->end());
+        m_query.m_indices = m_indices.data();
+        m_query.m_bucket_begin = m_bucket_begin.data();
+        m_query.m_bucket_end = m_bucket_end.data();
+        m_query.m_nbuckets = nbuckets;
+    }
+
+    ParticlesType* m_parent;
+    std::vector<size_t> m_indices;
+    std::vector<size_t> m_ids;
+    bool m_searchable;
+    typename traits_type::unsigned_int_d m_size;
+    std::vector<unsigned int> m_bucket_begin;
+    std::vector<unsigned int> m_bucket_end;
+    query_type m_query;
+};
+
+/// traits class to detect a ParticlesView
+template <typename T>
+struct is_particles_view: std::false_type {};
+
+template <typename ParticlesType>
+struct is_particles_view<ParticlesView<ParticlesType>>: std::true_type {};
+
+}
+
+#endif /* PARTICLES_VIEW_H_ */
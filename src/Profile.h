@@ -0,0 +1,251 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <string>
+#include <map>
+#include <vector>
+#include <ostream>
+#include <chrono>
+
+// The symbolic evaluator is instrumented only if ABORIA_PROFILE is defined
+// (e.g. using the cmake option Aboria_USE_PROFILE), otherwise the code 
+// within ABORIA_PROFILE_ONLY is compiled out
+#ifdef ABORIA_PROFILE
+#define ABORIA_PROFILE_ONLY(...) __VA_ARGS__
+#else
+#define ABORIA_PROFILE_ONLY(...)
+#endif
+
+namespace Aboria {
+
+/// The timings and pair counts recorded for one tag by the instrumented
+/// symbolic evaluator 
+struct StatementProfile {
+    /// the number of statements evaluated 
+    size_t calls;
+    /// the total wall time of the statements in seconds
+    double time;
+    /// the number of candidate pairs of particles examined by the neighbour
+    /// sums and reductions
+    size_t candidates;
+    /// the number of candidate pairs for which the condition was true
+    size_t accepted;
+    /// the number of evaluations of the summed expressions
+    size_t evaluations;
+
+    StatementProfile():
+        calls(0),time(0),candidates(0),accepted(0),evaluations(0) {}
+};
+
+/// Records the timings and pair counts of the symbolic statements, grouped 
+/// by a statement tag. Statements are tagged with the tag given by the
+/// innermost ProfileTag in scope, or by default with the names of the 
+/// variables they assign to (global reductions are tagged "reduce"). 
+/// Nothing is recorded unless Aboria is compiled with ABORIA_PROFILE defined.
+///
+/// \see symbolic_profile
+class SymbolicProfile {
+public:
+    typedef std::map<std::string,StatementProfile> profiles_type;
+
+    SymbolicProfile():m_current(nullptr) {}
+
+    /// returns the recorded profiles, indexed by tag
+    const profiles_type& get_profiles() const { return m_profiles; }
+
+    /// removes all the recorded profiles
+    void reset() { 
+        m_profiles.clear(); 
+        m_current = nullptr;
+    }
+
+    /// writes the recorded profiles to \p out as a JSON object, with one 
+    /// member for each tag
+    void write_json(std::ostream& out) const {
+        out << "{";
+        for (profiles_type::const_iterator i=m_profiles.begin(); i!=m_profiles.end(); ++i) {
+            const StatementProfile& p = i->second;
+            out << (i==m_profiles.begin()?"\n":",\n");
+            out << "  \"" << escape(i->first,'\\') << "\": {"
+                << "\"calls\": " << p.calls
+                << ", \"time\": " << p.time
+                << ", \"candidates\": " << p.candidates
+                << ", \"accepted\": " << p.accepted
+                << ", \"evaluations\": " << p.evaluations << "}";
+        }
+        out << "\n}\n";
+    }
+
+    /// writes the recorded profiles to \p out as comma separated values, 
+    /// with a header line and one line for each tag
+    void write_csv(std::ostream& out) const {
+        out << "tag,calls,time,candidates,accepted,evaluations\n";
+        for (profiles_type::const_iterator i=m_profiles.begin(); i!=m_profiles.end(); ++i) {
+            const StatementProfile& p = i->second;
+            out << "\"" << escape(i->first,'"') << "\","
+                << p.calls << ',' << p.time << ',' << p.candidates << ','
+                << p.accepted << ',' << p.evaluations << '\n';
+        }
+    }
+
+    // the tags set by the ProfileTag objects in scope
+    std::vector<std::string>& get_tags() { return m_tags; }
+
+    // the profile of the statement currently being evaluated, or nullptr
+    // if there is none
+    StatementProfile* get_current() { return m_current; }
+
+    // starts a statement with default tag \p tag, returning the previous
+    // statement. A statement started during another is counted as part of it
+    StatementProfile* begin_statement(const std::string& tag) {
+        StatementProfile* previous = m_current;
+        if (previous == nullptr) {
+            m_current = &m_profiles[m_tags.empty()?tag:m_tags.back()];
+        }
+        return previous;
+    }
+
+    // ends the current statement, which took \p time seconds 
+    void end_statement(StatementProfile* previous, const double time) {
+        if (previous == nullptr) {
+            m_current->calls++;
+            m_current->time += time;
+            m_current = nullptr;
+        }
+    }
+
+private:
+    static std::string escape(const std::string& tag, const char escape_char) {
+        std::string escaped;
+        for (const char c: tag) {
+            if (c == '"' || c == '\\') escaped += escape_char;
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    profiles_type m_profiles;
+    std::vector<std::string> m_tags;
+    StatementProfile* m_current;
+};
+
+/// returns the profile of the symbolic statements evaluated so far, e.g.
+///
+/// symbolic_profile().write_json(std::cout);
+inline SymbolicProfile& symbolic_profile() {
+    static SymbolicProfile profile;
+    return profile;
+}
+
+/// Tags all the symbolic statements evaluated during its lifetime with 
+/// \p tag in the symbolic_profile, e.g.
+///
+/// {
+///     ProfileTag tag("density");
+///     rho[a] = sum(b,norm(dx)<2*h,m[b]*W(norm(dx),h));
+/// }
+class ProfileTag {
+public:
+    explicit ProfileTag(const std::string& tag) {
+        symbolic_profile().get_tags().push_back(tag);
+    }
+    ~ProfileTag() {
+        symbolic_profile().get_tags().pop_back();
+    }
+    ProfileTag(const ProfileTag&) = delete;
+    ProfileTag& operator=(const ProfileTag&) = delete;
+};
+
+namespace detail {
+
+// times a symbolic statement over its lifetime, recording it in the 
+// symbolic_profile under the current ProfileTag, or by default the names of
+// the variables in \p VariableTypes
+template <typename... VariableTypes>
+class profile_statement {
+    typedef std::chrono::steady_clock clock_type;
+public:
+    profile_statement():
+        m_previous(symbolic_profile().begin_statement(names())),
+        m_start(clock_type::now()) {}
+
+    explicit profile_statement(const std::string& tag):
+        m_previous(symbolic_profile().begin_statement(tag)),
+        m_start(clock_type::now()) {}
+
+    ~profile_statement() {
+        const std::chrono::duration<double> time = clock_type::now()-m_start;
+        symbolic_profile().end_statement(m_previous,time.count());
+    }
+
+private:
+    static std::string names() {
+        std::string names;
+        const char* variable_names[] = {VariableTypes().name...};
+        for (const char* name: variable_names) {
+            names += names.empty()?name:std::string(",")+name;
+        }
+        return names;
+    }
+
+    StatementProfile* m_previous;
+    clock_type::time_point m_start;
+};
+
+// adds the pair counts of a neighbour sum or reduction to the statement
+// currently being evaluated, if any. Can be called from within a parallel 
+// loop
+inline void profile_pairs(const size_t candidates, const size_t accepted, 
+                          const size_t evaluations) {
+    StatementProfile* current = symbolic_profile().get_current();
+    if (current == nullptr) return;
+    #pragma omp atomic
+    current->candidates += candidates;
+    #pragma omp atomic
+    current->accepted += accepted;
+    #pragma omp atomic
+    current->evaluations += evaluations;
+}
+
+}
+
+}
+
+#endif
@@ -184,7 +184,7 @@ public:
     CUDA_HOST_DEVICE
     bool check_candidate() {
         //const double_d& p = get<position>(*m_current_particle) + m_particle_range.get_transpose();
-        const double_d& p = get<position>(*m_current_particle); 
+        const auto& p = get<position>(*m_current_particle); 
         const double_d& transpose = m_particle_range.get_transpose();
         bool outside = false;
         for (int i=0; i < Traits::dimension; i++) {
@@ -431,6 +431,20 @@ namespace Aboria {
         }
     };
 
+    /// evaluate a global reduction of \p expr over all the particles referred
+    /// to by \p label, using the accumulation \p accum. This is equivalent to 
+    /// `eval(accum(label,true,expr))`. The reduction is evaluated in parallel, 
+    /// and gives the same result regardless of the number of threads used
+    /// \code
+    ///     Accumulate<max<double>> max;
+    ///     const double vmax = reduce(max, a, norm(v[a]));
+    /// \endcode
+    template <typename T, typename LabelType, typename Expr>
+    typename T::result_type
+    reduce(const Accumulate<T>& accum, LabelType& label, Expr const& expr) {
+        return eval(accum(label,true,expr));
+    }
+
     /*
     /// a symbolic class that refers to a Geometry class. 
     template <typename T>
@@ -5,6 +5,7 @@
 #include "Vector.h"
 #include "CudaInclude.h"
 #include "Get.h"
+#include "MmapVector.h"
 #include <tuple>
 #include <vector>
 #include <boost/iterator/counting_iterator.hpp>
@@ -17,7 +18,14 @@ namespace Aboria {
 namespace mpl = boost::mpl;
 
 
+/// \brief the default traits used by Particles
+///
+/// \param POSITION_T the element type used to store the particle positions,
+/// e.g. `double` (the default) or `float`
+template <typename POSITION_T=double>
 struct default_traits {
+    typedef POSITION_T position_element_type;
+
     template <typename T>
     struct vector_type {
         typedef std::vector<T> type;
@@ -25,15 +33,28 @@ struct default_traits {
 
 };
 
-template<template<typename,typename> class VECTOR>
+/// \brief traits for the container type `VECTOR`, which can also be used to
+/// set the element type of the particle positions. For example, 
+/// `Traits<std::vector,float>` stores positions in single precision
+template<template<typename,typename> class VECTOR, typename POSITION_T=double>
 struct Traits {};
 
-template <>
-struct Traits<std::vector>: public default_traits {};
+template <typename POSITION_T>
+struct Traits<std::vector,POSITION_T>: public default_traits<POSITION_T> {};
+
+#ifndef _WIN32
+template <typename POSITION_T>
+struct Traits<mmap_vector,POSITION_T>: public default_traits<POSITION_T> {
+    template <typename T>
+    struct vector_type {
+        typedef mmap_vector<T> type;
+    };
+};
+#endif
 
 #if defined(__CUDACC__)
-template <>
-struct Traits<thrust::device_vector>: public default_traits {
+template <typename POSITION_T>
+struct Traits<thrust::device_vector,POSITION_T>: public default_traits<POSITION_T> {
     template <typename T>
     struct vector_type {
         typedef thrust::device_vector<T> type;
@@ -141,7 +162,7 @@ struct TraitsCommon<std::tuple<TYPES...>,D,traits>:public traits {
     typedef Vector<unsigned int,dimension> unsigned_int_d;
     typedef Vector<bool,dimension> bool_d;
 
-    typedef position_d<dimension> position;
+    typedef position_d<dimension,typename traits::position_element_type> position;
     typedef typename position::value_type position_value_type;
     typedef alive::value_type alive_value_type;
     typedef id::value_type id_value_type;
@@ -218,6 +239,11 @@ struct TraitsCommon<std::tuple<TYPES...>,D,traits>:public traits {
         return iterator(get_by_index<I>(data).end()...);
     }
 
+    template<std::size_t... I>
+    static const_iterator cbegin_impl(const data_type& data, detail::index_sequence<I...>) {
+        return const_iterator(get_by_index<I>(data).cbegin()...);
+    }
+
     template<std::size_t... I>
     static reference index_impl(data_type& data, const size_t i, detail::index_sequence<I...>, std::true_type) {
         return reference(get_by_index<I>(data)[i]...);
@@ -250,6 +276,12 @@ struct TraitsCommon<std::tuple<TYPES...>,D,traits>:public traits {
         static_cast<void>(dummy);
     }
 
+    template<std::size_t... I>
+    static void reserve_impl(data_type& data, const size_t new_size, detail::index_sequence<I...>) {
+        int dummy[] = { 0, (get_by_index<I>(data).reserve(new_size),void(),0)... };
+        static_cast<void>(dummy);
+    }
+
     template<std::size_t... I>
     static void push_back_impl(data_type& data, const value_type& val, detail::index_sequence<I...>) {
         int dummy[] = { 0, (get_by_index<I>(data).push_back(get_by_index<I>(val)),void(),0)... };
@@ -290,6 +322,11 @@ struct TraitsCommon<std::tuple<TYPES...>,D,traits>:public traits {
         return end_impl(data, Indices());
     }
 
+    template<typename Indices = detail::make_index_sequence<N>>
+    static const_iterator cbegin(const data_type& data) {
+        return cbegin_impl(data, Indices());
+    }
+
     template<typename Indices = detail::make_index_sequence<N>>
     static reference index(data_type& data, const size_t i) {
         return index_impl(data, i, Indices(),std::is_reference<decltype(get<id>(data)[0])>());
@@ -310,6 +347,11 @@ struct TraitsCommon<std::tuple<TYPES...>,D,traits>:public traits {
         resize_impl(data, new_size, Indices());
     }
 
+    template<typename Indices = detail::make_index_sequence<N>>
+    static void reserve(data_type& data, const size_t new_size) {
+        reserve_impl(data, new_size, Indices());
+    }
+
     template<typename Indices = detail::make_index_sequence<N>>
     static void push_back(data_type& data, const value_type& val) {
         push_back_impl(data, val, Indices());
@@ -0,0 +1,324 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <boost/mpl/vector.hpp>
+#include <boost/mpl/for_each.hpp>
+
+#include "Particles.h"
+#include "detail/Trajectory.h"
+#include "Log.h"
+
+namespace Aboria {
+
+/// writes the trajectories of the particles in a container to a compact
+/// binary file, which can be read with trajectory_reader. 
+///
+/// Each frame stores the position and the variables \p Variables (which 
+/// must be arithmetic or Vector variables) of every particle. Every 
+/// \p keyframe_interval frames a keyframe is stored, and the frames in 
+/// between store only the change in each value since the previous frame,
+/// as variable length integers. Particles are matched between frames by 
+/// their id, so reordering by the neighbourhood search, or adding and
+/// removing particles, does not affect the size of the deltas. 
+///
+/// If \p tolerance is zero the values are stored exactly, otherwise they 
+/// are rounded to a multiple of \p tolerance (so the error is at most 
+/// tolerance/2), which gives much smaller deltas.
+///
+/// \code
+/// trajectory_writer<MyParticles,velocity> writer("run.traj",1e-6);
+/// for (int i=0; i<nout; ++i) {
+///     // ... timesteps ...
+///     writer.write(particles,time);
+/// }
+/// writer.close();
+/// \endcode
+template <typename ParticlesType, typename ... Variables>
+class trajectory_writer {
+    typedef typename ParticlesType::position position;
+    typedef mpl::vector<position,Variables...> variables_type;
+
+public:
+    /// create the trajectory file \p filename
+    trajectory_writer(const std::string& filename, const double tolerance = 0, 
+                      const unsigned int keyframe_interval = 10):
+        m_os(filename,std::ios::binary),
+        m_quantiser(tolerance),
+        m_keyframe_interval(keyframe_interval),
+        m_ncomponents(0)
+    {
+        CHECK(m_os,"could not open "<<filename<<" for writing");
+        CHECK(tolerance >= 0,"trajectory tolerance must be non-negative");
+        CHECK(keyframe_interval > 0,"keyframe interval must be positive");
+        std::vector<std::string> names;
+        std::vector<unsigned int> ncomponents;
+        mpl::for_each<variables_type>(detail::get_trajectory_columns(names,ncomponents));
+
+        m_os.write(detail::trajectory_magic,sizeof(detail::trajectory_magic));
+        detail::write_binary(m_os,detail::trajectory_version);
+        detail::write_binary(m_os,tolerance);
+        detail::write_binary(m_os,uint32_t(keyframe_interval));
+        detail::write_binary(m_os,uint32_t(names.size()));
+        for (size_t i=0; i<names.size(); ++i) {
+            detail::write_binary_string(m_os,names[i]);
+            detail::write_binary(m_os,uint32_t(ncomponents[i]));
+            m_ncomponents += ncomponents[i];
+        }
+    }
+
+    trajectory_writer(const trajectory_writer&) = delete;
+    trajectory_writer& operator=(const trajectory_writer&) = delete;
+
+    ~trajectory_writer() {
+        close();
+    }
+
+    /// append a frame holding the current state of \p particles at \p time
+    void write(const ParticlesType& particles, const double time = 0) {
+        CHECK(m_os.is_open(),"trajectory file has been closed");
+        const size_t n = particles.size();
+
+        // sort the particles by id
+        std::vector<size_t> order(n);
+        for (size_t i=0; i<n; ++i) order[i] = i;
+        const auto& ids = get<id>(particles);
+        std::sort(order.begin(),order.end(),
+                [&ids](const size_t a, const size_t b) { return ids[a] < ids[b]; });
+
+        m_current.ids.resize(n);
+        for (size_t i=0; i<n; ++i) m_current.ids[i] = ids[order[i]];
+        m_current.values.resize(n*m_ncomponents);
+        size_t offset = 0;
+        mpl::for_each<variables_type>(
+                detail::gather_trajectory_columns<ParticlesType>(
+                    particles,order,m_ncomponents,m_quantiser,m_current.values,offset));
+
+        const bool keyframe = m_offsets.size() % m_keyframe_interval == 0;
+        if (keyframe) m_previous = detail::trajectory_state();
+        m_buffer.clear();
+        detail::encode_trajectory_frame(m_current,m_previous,m_ncomponents,
+                                        m_quantiser,m_buffer);
+
+        m_offsets.push_back(m_os.tellp());
+        m_times.push_back(time);
+        m_keyframes.push_back(keyframe);
+        detail::write_binary(m_os,uint8_t(keyframe));
+        detail::write_binary(m_os,time);
+        detail::write_binary(m_os,uint64_t(n));
+        detail::write_binary(m_os,uint64_t(m_buffer.size()));
+        m_os.write(m_buffer.data(),m_buffer.size());
+        LOG(2,"trajectory_writer: wrote frame "<<m_offsets.size()-1<<" with "<<n<<" particles in "<<m_buffer.size()<<" bytes");
+
+        std::swap(m_previous,m_current);
+    }
+
+    /// the number of frames written
+    size_t size() const {
+        return m_offsets.size();
+    }
+
+    /// write the frame index (used for random access) and close the file
+    void close() {
+        if (!m_os.is_open()) return;
+        const uint64_t index_offset = m_os.tellp();
+        detail::write_binary(m_os,uint64_t(m_offsets.size()));
+        for (size_t i=0; i<m_offsets.size(); ++i) {
+            detail::write_binary(m_os,uint64_t(m_offsets[i]));
+            detail::write_binary(m_os,m_times[i]);
+            detail::write_binary(m_os,m_keyframes[i]);
+        }
+        detail::write_binary(m_os,index_offset);
+        m_os.close();
+    }
+
+private:
+    std::ofstream m_os;
+    detail::trajectory_quantiser m_quantiser;
+    unsigned int m_keyframe_interval;
+    size_t m_ncomponents;
+    detail::trajectory_state m_previous;
+    detail::trajectory_state m_current;
+    std::vector<char> m_buffer;
+    std::vector<std::streamoff> m_offsets;
+    std::vector<double> m_times;
+    std::vector<uint8_t> m_keyframes;
+};
+
+/// reads frames from a file written by trajectory_writer, in any order
+class trajectory_reader {
+public:
+    /// open the trajectory file \p filename and read its frame index
+    trajectory_reader(const std::string& filename):
+        m_is(filename,std::ios::binary),
+        m_quantiser(0),
+        m_ncomponents(0),
+        m_current_frame(-1)
+    {
+        CHECK(m_is,"could not open "<<filename<<" for reading");
+        char magic[sizeof(detail::trajectory_magic)];
+        m_is.read(magic,sizeof(magic));
+        CHECK(m_is && std::equal(magic,magic+sizeof(magic),detail::trajectory_magic),
+                filename<<" is not an Aboria trajectory file");
+        uint32_t version,keyframe_interval,ncolumns;
+        detail::read_binary(m_is,version);
+        CHECK(version == detail::trajectory_version,"trajectory version "<<version<<" is not supported");
+        detail::read_binary(m_is,m_quantiser.tolerance);
+        detail::read_binary(m_is,keyframe_interval);
+        detail::read_binary(m_is,ncolumns);
+        m_names.resize(ncolumns);
+        m_offsets.resize(ncolumns);
+        m_sizes.resize(ncolumns);
+        for (size_t i=0; i<ncolumns; ++i) {
+            detail::read_binary_string(m_is,m_names[i]);
+            detail::read_binary(m_is,m_sizes[i]);
+            m_offsets[i] = m_ncomponents;
+            m_ncomponents += m_sizes[i];
+        }
+
+        uint64_t index_offset,nframes;
+        m_is.seekg(-std::streamoff(sizeof(uint64_t)),std::ios::end);
+        detail::read_binary(m_is,index_offset);
+        m_is.seekg(index_offset);
+        detail::read_binary(m_is,nframes);
+        CHECK(m_is,"could not read the frame index of "<<filename<<", was the trajectory_writer closed?");
+        m_frame_offsets.resize(nframes);
+        m_times.resize(nframes);
+        m_keyframes.resize(nframes);
+        for (size_t i=0; i<nframes; ++i) {
+            detail::read_binary(m_is,m_frame_offsets[i]);
+            detail::read_binary(m_is,m_times[i]);
+            detail::read_binary(m_is,m_keyframes[i]);
+        }
+    }
+
+    /// the number of frames in the file
+    size_t size() const {
+        return m_frame_offsets.size();
+    }
+
+    /// the time of frame \p frame
+    double time(const size_t frame) const {
+        return m_times[frame];
+    }
+
+    /// the names of the stored variables. The first is the position
+    const std::vector<std::string>& names() const {
+        return m_names;
+    }
+
+    /// the tolerance the values were stored to (zero if exact)
+    double tolerance() const {
+        return m_quantiser.tolerance;
+    }
+
+    /// read frame \p frame. Decoding starts from the previous keyframe, or
+    /// continues from the last frame read if that is closer, so reading 
+    /// frames in order only decodes each frame once. Afterwards ids() and 
+    /// get() return the data for this frame
+    void read(const size_t frame) {
+        CHECK(frame < size(),"frame "<<frame<<" is out of range");
+        if (int64_t(frame) == m_current_frame) return;
+        size_t start = frame;
+        while (!m_keyframes[start] && int64_t(start) != m_current_frame+1) {
+            --start;
+        }
+        for (size_t i=start; i<=frame; ++i) {
+            read_frame(i);
+        }
+    }
+
+    /// the ids of the particles in the last frame read, in increasing order
+    const std::vector<size_t>& ids() const {
+        return m_current.ids;
+    }
+
+    /// component \p c of the variable named \p name for the \p i-th 
+    /// particle (in the order given by ids()) of the last frame read
+    double get(const std::string& name, const size_t i, const unsigned int c = 0) const {
+        const size_t column = std::find(m_names.begin(),m_names.end(),name) - m_names.begin();
+        CHECK(column < m_names.size(),"trajectory has no variable "<<name);
+        CHECK(c < m_sizes[column],"variable "<<name<<" has only "<<m_sizes[column]<<" components");
+        return m_quantiser.dequantise(
+                m_current.values[i*m_ncomponents+m_offsets[column]+c]);
+    }
+
+private:
+    void read_frame(const size_t frame) {
+        uint8_t keyframe;
+        double time;
+        uint64_t n,nbytes;
+        m_is.clear();
+        m_is.seekg(m_frame_offsets[frame]);
+        detail::read_binary(m_is,keyframe);
+        detail::read_binary(m_is,time);
+        detail::read_binary(m_is,n);
+        detail::read_binary(m_is,nbytes);
+        m_buffer.resize(nbytes);
+        m_is.read(m_buffer.data(),nbytes);
+        CHECK(m_is,"error reading frame "<<frame);
+        if (keyframe) m_previous = detail::trajectory_state();
+        else std::swap(m_previous,m_current);
+        detail::decode_trajectory_frame(m_buffer.data(),n,m_previous,
+                                        m_ncomponents,m_quantiser,m_current);
+        m_current_frame = frame;
+    }
+
+    std::ifstream m_is;
+    detail::trajectory_quantiser m_quantiser;
+    std::vector<std::string> m_names;
+    std::vector<uint32_t> m_sizes;
+    std::vector<size_t> m_offsets;
+    size_t m_ncomponents;
+    std::vector<uint64_t> m_frame_offsets;
+    std::vector<double> m_times;
+    std::vector<uint8_t> m_keyframes;
+    std::vector<char> m_buffer;
+    detail::trajectory_state m_previous;
+    detail::trajectory_state m_current;
+    int64_t m_current_frame;
+};
+
+}
+
+#endif /* TRAJECTORY_H_ */
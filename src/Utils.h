@@ -180,6 +180,63 @@ void radial_distribution_function(const T& particles,
 	particles->reset_neighbour_search(old_size);
 }
 
+/// finds the neighbours within \p radius of every particle in \p particles
+/// in a single pass over the neighbourhood search, and stores them in 
+/// compressed sparse row form. The neighbours of particle i are at 
+/// \p indices[\p indptr[i]] to \p indices[\p indptr[i+1]-1], with the 
+/// distance to each neighbour in \p distances. \p radius must not be 
+/// larger than the length scale of the neighbourhood search. Particles are
+/// not counted as their own neighbours
+template<typename ParticlesType>
+void neighbours_csr(const ParticlesType& particles, const double radius,
+                    std::vector<int64_t>& indptr,
+                    std::vector<int64_t>& indices,
+                    std::vector<double>& distances) {
+    typedef typename ParticlesType::position position;
+    typedef typename ParticlesType::const_reference const_reference;
+    CHECK(!(particles.get_lengthscale() < radius).any(),
+          "neighbours_csr: radius is larger than the search length scale");
+    const size_t n = particles.size();
+    const double radius2 = radius*radius;
+    const auto* begin = get<position>(particles).data();
+
+    // count the neighbours of each particle, then fill them in
+    indptr.assign(n+1,0);
+    #pragma omp parallel for
+    for (size_t i=0; i<n; ++i) {
+        const auto& ri = get<position>(particles)[i];
+        int64_t count = 0;
+        for (auto pairj: box_search(particles.get_query(),ri)) {
+            const_reference bj = tuple_ns::get<0>(pairj);
+            if (&get<position>(bj) != &ri 
+                    && tuple_ns::get<1>(pairj).squaredNorm() <= radius2) {
+                ++count;
+            }
+        }
+        indptr[i+1] = count;
+    }
+    for (size_t i=0; i<n; ++i) {
+        indptr[i+1] += indptr[i];
+    }
+
+    indices.resize(indptr[n]);
+    distances.resize(indptr[n]);
+    #pragma omp parallel for
+    for (size_t i=0; i<n; ++i) {
+        const auto& ri = get<position>(particles)[i];
+        int64_t k = indptr[i];
+        for (auto pairj: box_search(particles.get_query(),ri)) {
+            const_reference bj = tuple_ns::get<0>(pairj);
+            const double r2 = tuple_ns::get<1>(pairj).squaredNorm();
+            if (&get<position>(bj) != &ri && r2 <= radius2) {
+                indices[k] = &get<position>(bj) - begin;
+                distances[k] = std::sqrt(r2);
+                ++k;
+            }
+        }
+    }
+}
+
 }
 
 #endif /* UTILS_H_ */
@@ -71,7 +71,17 @@ struct Variable {
     using NAME = Variable<Vector<DATA_TYPE,N>,BOOST_PP_CAT(NAME,_description)>;   \
 
 
-ABORIA_VARIABLE_VECTOR(position_d,double,"position")
+/// \brief the built-in position variable
+///
+/// \param N the spatial dimension
+/// \param T the element type used to store each coordinate. This defaults to
+/// `double`, use `float` to halve the memory used by the positions
+struct position_d_description {
+    const char* name = "position";
+};
+template <unsigned int N, typename T=double>
+using position_d = Variable<Vector<T,N>,position_d_description>;
+
 ABORIA_VARIABLE(alive,uint8_t,"is alive")
 ABORIA_VARIABLE(id,size_t,"id")
 ABORIA_VARIABLE(random,generator_type,"random")
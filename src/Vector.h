@@ -42,6 +42,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "CudaInclude.h"
 
 #include <iostream>
+#include <type_traits>
+#include <utility>
 
 
 namespace Aboria {
@@ -138,7 +140,7 @@ public:
     /// \param arg Assigns the first N values from arg to this vector.
 	template<typename T2>
     CUDA_HOST_DEVICE
-	Vector<T,N> &operator =(Vector<T2,N> &arg) {
+	Vector<T,N> &operator =(const Vector<T2,N> &arg) {
 		for (int i = 0; i < N; ++i) {
 			mem[i] = arg[i];
 		}
@@ -361,11 +363,37 @@ bool operator ==(const Vector<T1,N> &arg1, const Vector<T2,N> &arg2) {
 */
 
 
+/// \brief the element type resulting from a binary operation between
+/// two Vector element types
+///
+/// Follows the normal C++ promotion rules, so `Vector<float,N>+Vector<float,N>`
+/// stays in single precision and `Vector<float,N>+Vector<double,N>` is promoted
+/// to double
+template<typename T1,typename T2>
+struct vector_promote {
+    typedef typename std::decay<decltype(std::declval<T1>()+std::declval<T2>())>::type type;
+};
+
+/// \brief the element type resulting from a binary operation between a
+/// Vector with element type `T` and a scalar of type `S`
+///
+/// A floating point Vector keeps its precision when combined with an arithmetic
+/// scalar (e.g. `Vector<float,N>*2.0` is a `Vector<float,N>`), otherwise the
+/// normal C++ promotion rules apply (e.g. `Vector<int,N>*0.5` is a
+/// `Vector<double,N>`)
+template<typename T,typename S>
+struct vector_scalar_promote {
+    typedef typename std::conditional<std::is_floating_point<T>::value,
+                        T,
+                        typename vector_promote<T,S>::type>::type type;
+};
+
 #define UNARY_OPERATOR(the_op) \
     template<typename T,unsigned int N> \
     CUDA_HOST_DEVICE \
-    Vector<double,N> operator the_op(const Vector<T,N> &arg1) { \
-        Vector<double,N> ret; \
+    Vector<typename std::decay<decltype(the_op std::declval<T>())>::type,N> \
+    operator the_op(const Vector<T,N> &arg1) { \
+        Vector<typename std::decay<decltype(the_op std::declval<T>())>::type,N> ret; \
         for (int i = 0; i < N; ++i) { \
             ret[i] = the_op arg1[i]; \
         } \
@@ -379,59 +407,36 @@ UNARY_OPERATOR(-)
 #define OPERATOR(the_op) \
     template<typename T1,typename T2,unsigned int N> \
     CUDA_HOST_DEVICE \
-    Vector<double,N> operator the_op(const Vector<T1,N> &arg1, const Vector<T2,N> &arg2) { \
-        Vector<double,N> ret; \
+    Vector<typename vector_promote<T1,T2>::type,N> \
+    operator the_op(const Vector<T1,N> &arg1, const Vector<T2,N> &arg2) { \
+        Vector<typename vector_promote<T1,T2>::type,N> ret; \
         for (int i = 0; i < N; ++i) { \
             ret[i] = arg1[i] the_op arg2[i]; \
         } \
         return ret; \
     } \
-    template<typename T1,typename T2,unsigned int N> \
+    template<typename T1,typename T2,unsigned int N, \
+        typename = typename std::enable_if<std::is_arithmetic<T2>::value>::type> \
     CUDA_HOST_DEVICE \
-    Vector<double,N> operator the_op(const Vector<T1,N> &arg1, const T2 &arg2) { \
-        Vector<double,N> ret; \
+    Vector<typename vector_scalar_promote<T1,T2>::type,N> \
+    operator the_op(const Vector<T1,N> &arg1, const T2 &arg2) { \
+        Vector<typename vector_scalar_promote<T1,T2>::type,N> ret; \
         for (int i = 0; i < N; ++i) { \
             ret[i] = arg1[i] the_op arg2; \
         } \
         return ret; \
     } \
-    template<typename T1,typename T2,unsigned int N> \
-    CUDA_HOST_DEVICE \
-    Vector<double,N> operator the_op(const T1 &arg1, const Vector<T2,N> &arg2) { \
-        Vector<double,N> ret; \
-        for (int i = 0; i < N; ++i) { \
-            ret[i] = arg1 the_op arg2[i]; \
-        } \
-        return ret; \
-    } \
-    \
-    template<int,int,unsigned int N> \
-    CUDA_HOST_DEVICE \
-    Vector<int,N> operator the_op(const Vector<int,N> &arg1, const Vector<int,N> &arg2) { \
-        Vector<int,N> ret; \
-        for (int i = 0; i < N; ++i) { \
-            ret[i] = arg1[i] the_op arg2[i]; \
-        } \
-        return ret; \
-    } \
-    template<int,int,unsigned int N> \
+    template<typename T1,typename T2,unsigned int N, \
+        typename = typename std::enable_if<std::is_arithmetic<T1>::value>::type> \
     CUDA_HOST_DEVICE \
-    Vector<int,N> operator the_op(const int &arg1, const Vector<int,N> &arg2) { \
-        Vector<int,N> ret; \
+    Vector<typename vector_scalar_promote<T2,T1>::type,N> \
+    operator the_op(const T1 &arg1, const Vector<T2,N> &arg2) { \
+        Vector<typename vector_scalar_promote<T2,T1>::type,N> ret; \
         for (int i = 0; i < N; ++i) { \
             ret[i] = arg1 the_op arg2[i]; \
         } \
         return ret; \
     } \
-    template<int,int,unsigned int N> \
-    CUDA_HOST_DEVICE \
-    Vector<int,N> operator the_op(const Vector<int,N> &arg1, const int &arg2) { \
-        Vector<int,N> ret; \
-        for (int i = 0; i < N; ++i) { \
-            ret[i] = arg1[i] the_op arg2; \
-        } \
-        return ret; \
-    } \
 
 
 /// binary `+` operator for Vector class
@@ -503,32 +508,16 @@ COMPARISON(!=)
 #define COMPOUND_ASSIGN(the_op) \
     template<typename T1,typename T2,unsigned int N> \
     CUDA_HOST_DEVICE \
-    Vector<double,N> &operator the_op(Vector<T1,N> &arg1, const Vector<T2,N> &arg2) { \
-        for (int i = 0; i < N; ++i) { \
-            arg1[i] the_op arg2[i]; \
-        } \
-        return arg1; \
-    } \
-    template<typename T1,typename T2,unsigned int N> \
-    CUDA_HOST_DEVICE \
-    Vector<double,N> &operator the_op(Vector<T1,N> &arg1, const T2 &arg2) { \
-        for (int i = 0; i < N; ++i) { \
-            arg1[i] the_op arg2; \
-        } \
-        return arg1; \
-    } \
-    \
-    template<int,int,unsigned int N> \
-    CUDA_HOST_DEVICE \
-    Vector<int,N> &operator the_op(Vector<int,N> &arg1, const Vector<int,N> &arg2) { \
+    Vector<T1,N> &operator the_op(Vector<T1,N> &arg1, const Vector<T2,N> &arg2) { \
         for (int i = 0; i < N; ++i) { \
             arg1[i] the_op arg2[i]; \
         } \
         return arg1; \
     } \
-    template<int,int,unsigned int N> \
+    template<typename T1,typename T2,unsigned int N, \
+        typename = typename std::enable_if<std::is_arithmetic<T2>::value>::type> \
     CUDA_HOST_DEVICE \
-    Vector<int,N> &operator the_op(Vector<int,N> &arg1, const int &arg2) { \
+    Vector<T1,N> &operator the_op(Vector<T1,N> &arg1, const T2 &arg2) { \
         for (int i = 0; i < N; ++i) { \
             arg1[i] the_op arg2; \
         } \
@@ -619,7 +608,7 @@ inline const Vector<T,N> imag(const Vector<T,N>& x)  { return 0; }
 template <typename T, unsigned int N>
 inline const Vector<T,N> abs(const Vector<T,N>& x)  { 
 	Vector<T,N> ret;
-    for (int i; i<N; ++i) {
+    for (int i=0; i<N; ++i) {
         ret[i] = std::fabs(x[i]);
     }
     return ret; 
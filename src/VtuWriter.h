@@ -0,0 +1,415 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+#ifndef VTU_WRITER_H_
+#define VTU_WRITER_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+#include <boost/mpl/for_each.hpp>
+#include <boost/mpl/range_c.hpp>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "Vector.h"
+#include "Get.h"
+#include "Log.h"
+
+namespace Aboria {
+
+namespace detail {
+
+/// returns the VTK type name (e.g. "Float64", "UInt8") of type \p T
+template <typename T>
+std::string vtk_type_name() {
+    static_assert(std::is_arithmetic<T>::value,"VTK data arrays must be arithmetic");
+    if (std::is_floating_point<T>::value) {
+        return sizeof(T) == 4 ? "Float32" : "Float64";
+    } else {
+        return std::string(std::is_signed<T>::value ? "Int" : "UInt") 
+            + std::to_string(8*sizeof(T));
+    }
+}
+
+inline std::string vtk_byte_order() {
+    const uint16_t one = 1;
+    return *reinterpret_cast<const char*>(&one) == 1 ? "LittleEndian" : "BigEndian";
+}
+
+inline std::string xml_escape(const std::string& value) {
+    std::string escaped;
+    for (char c: value) {
+        switch (c) {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/// a data array to be written to a .vtu file
+struct vtu_array {
+    std::string name;
+    std::string type;
+    unsigned int ncomponents;
+    /// the number of bytes in each tuple
+    size_t tuple_size;
+    /// the number of tuples
+    size_t n;
+    /// returns a pointer to the data for the tuples [first,first+count). 
+    /// Contiguous columns return a pointer into the column, otherwise the 
+    /// data is converted into buffer
+    std::function<const char*(size_t first, size_t count, std::vector<char>& buffer)> get_data;
+};
+
+/// returns a vtu_array for a contiguous column of \p n tuples of 
+/// \p ncomponents elements of type \p T
+template <typename T>
+vtu_array make_vtu_array(const std::string& name, const T* data, 
+                         const unsigned int ncomponents, const size_t n) {
+    vtu_array array;
+    array.name = name;
+    array.type = vtk_type_name<T>();
+    array.ncomponents = ncomponents;
+    array.tuple_size = ncomponents*sizeof(T);
+    array.n = n;
+    array.get_data = [=](size_t first, size_t, std::vector<char>&) {
+        return reinterpret_cast<const char*>(data + first*ncomponents);
+    };
+    return array;
+}
+
+/// adds a vtu_array for each arithmetic or Vector variable (apart from 
+/// position) of a particle container. Other variables, such as the 
+/// random generator, are skipped
+template <typename ParticlesType>
+struct add_vtu_arrays {
+    typedef typename ParticlesType::mpl_type_vector mpl_type_vector;
+    template <typename U>
+    using value_type = typename mpl::at<mpl_type_vector,U>::type::value_type;
+
+    add_vtu_arrays(const ParticlesType& particles, std::vector<vtu_array>& arrays):
+        particles(particles),arrays(arrays) {}
+
+    template <typename U> 
+    typename std::enable_if<std::is_arithmetic<value_type<U>>::value>::type
+    operator()(U) {
+        typedef typename mpl::at<mpl_type_vector,U>::type variable_type;
+        arrays.push_back(make_vtu_array(variable_type().name,
+                    get<variable_type>(particles).data(),1,particles.size()));
+    }
+
+    template <typename U> 
+    typename std::enable_if<is_vector<value_type<U>>::value>::type
+    operator()(U) {
+        typedef typename mpl::at<mpl_type_vector,U>::type variable_type;
+        typedef typename value_type<U>::value_type element_type;
+        const unsigned int N = value_type<U>::size;
+        arrays.push_back(make_vtu_array(variable_type().name,
+                    reinterpret_cast<const element_type*>(
+                        get<variable_type>(particles).data()),
+                    N,particles.size()));
+    }
+
+    template <typename U> 
+    typename std::enable_if<!std::is_arithmetic<value_type<U>>::value 
+                         && !is_vector<value_type<U>>::value>::type
+    operator()(U) {}
+
+    const ParticlesType& particles;
+    std::vector<vtu_array>& arrays;
+};
+
+/// returns the point data arrays of a particle container
+template <typename ParticlesType>
+std::vector<vtu_array> get_vtu_point_data(const ParticlesType& particles) {
+    typedef typename ParticlesType::mpl_type_vector mpl_type_vector;
+    std::vector<vtu_array> arrays;
+    mpl::for_each<mpl::range_c<int,1,mpl::size<mpl_type_vector>::type::value>>(
+            add_vtu_arrays<ParticlesType>(particles,arrays));
+    return arrays;
+}
+
+/// returns the points array of a particle container. VTK points always
+/// have three components, so positions are padded with zeros (or 
+/// truncated) if the dimension is not three
+template <typename ParticlesType>
+vtu_array get_vtu_points(const ParticlesType& particles) {
+    typedef typename ParticlesType::position position;
+    typedef typename position::value_type::value_type element_type;
+    const unsigned int D = ParticlesType::dimension;
+    const element_type* data = reinterpret_cast<const element_type*>(
+                                    get<position>(particles).data());
+    vtu_array array = make_vtu_array("Points",data,3,particles.size());
+    if (D != 3) {
+        array.get_data = [=](size_t first, size_t count, std::vector<char>& buffer) {
+            buffer.resize(count*3*sizeof(element_type));
+            element_type* out = reinterpret_cast<element_type*>(buffer.data());
+            for (size_t i=0; i<count; ++i) {
+                for (size_t d=0; d<3; ++d) {
+                    out[3*i+d] = d < D ? data[(first+i)*D+d] : 0;
+                }
+            }
+            return buffer.data();
+        };
+    }
+    return array;
+}
+
+/// returns an array of \p n tuples of type \p T, generated by \p f(i)
+template <typename T, typename F>
+vtu_array make_generated_vtu_array(const std::string& name, const size_t n, F f) {
+    vtu_array array;
+    array.name = name;
+    array.type = vtk_type_name<T>();
+    array.ncomponents = 1;
+    array.tuple_size = sizeof(T);
+    array.n = n;
+    array.get_data = [=](size_t first, size_t count, std::vector<char>& buffer) {
+        buffer.resize(count*sizeof(T));
+        T* out = reinterpret_cast<T*>(buffer.data());
+        for (size_t i=0; i<count; ++i) {
+            out[i] = f(first+i);
+        }
+        return buffer.data();
+    };
+    return array;
+}
+
+/// writes the data arrays of a .vtu file in the appended binary format, 
+/// one block at a time. The offset of each array is only known once the
+/// previous arrays have been written (and compressed), so fixed-width 
+/// placeholders are written in the XML header and filled in afterwards
+class vtu_appended_data {
+public:
+    static const size_t block_size = 1 << 20;
+    static const size_t offset_width = 20;
+
+    vtu_appended_data(std::ostream& os, const bool compress):
+        m_os(os),m_compress(compress) {}
+
+    /// write the XML DataArray element for \p array
+    void declare(const vtu_array& array) {
+        m_os << "<DataArray type=\"" << array.type 
+             << "\" Name=\"" << xml_escape(array.name)
+             << "\" NumberOfComponents=\"" << array.ncomponents 
+             << "\" format=\"appended\" offset=\"";
+        m_offset_positions.push_back(m_os.tellp());
+        m_os << std::string(offset_width,'0') << "\"/>\n";
+        m_arrays.push_back(&array);
+    }
+
+    /// write the data for all the declared arrays. The stream must be 
+    /// positioned after the '_' that starts the appended data
+    void write() {
+        const std::streampos start = m_os.tellp();
+        CHECK(start >= 0,"writing vtu files requires a seekable stream");
+        for (size_t i=0; i<m_arrays.size(); ++i) {
+            const std::streampos array_start = m_os.tellp();
+            write_array(*m_arrays[i]);
+            const std::streampos end = m_os.tellp();
+            m_os.seekp(m_offset_positions[i]);
+            m_os << std::setw(offset_width) << std::setfill('0') 
+                 << static_cast<uint64_t>(array_start-start);
+            m_os.seekp(end);
+        }
+    }
+
+private:
+    void write_array(const vtu_array& array) {
+        const uint64_t nbytes = array.n*array.tuple_size;
+        const size_t tuples_per_block = std::max(size_t(1),block_size/array.tuple_size);
+        const size_t nblocks = (array.n + tuples_per_block - 1)/tuples_per_block;
+        std::vector<char> buffer;
+        if (!m_compress) {
+            m_os.write(reinterpret_cast<const char*>(&nbytes),sizeof(uint64_t));
+            for (size_t b=0; b<nblocks; ++b) {
+                const size_t first = b*tuples_per_block;
+                const size_t count = std::min(tuples_per_block,array.n-first);
+                m_os.write(array.get_data(first,count,buffer),count*array.tuple_size);
+            }
+        } else {
+#ifdef HAVE_ZLIB
+            // header is [#blocks][block size][last block size][compressed sizes]
+            std::vector<uint64_t> header(3+nblocks,0);
+            header[0] = nblocks;
+            header[1] = tuples_per_block*array.tuple_size;
+            header[2] = nbytes % header[1];
+            const std::streampos header_position = m_os.tellp();
+            m_os.write(reinterpret_cast<const char*>(header.data()),
+                       header.size()*sizeof(uint64_t));
+            std::vector<Bytef> compressed;
+            for (size_t b=0; b<nblocks; ++b) {
+                const size_t first = b*tuples_per_block;
+                const size_t count = std::min(tuples_per_block,array.n-first);
+                const uLong block_bytes = count*array.tuple_size;
+                uLongf compressed_bytes = compressBound(block_bytes);
+                compressed.resize(compressed_bytes);
+                const int result = compress2(compressed.data(),&compressed_bytes,
+                        reinterpret_cast<const Bytef*>(array.get_data(first,count,buffer)),
+                        block_bytes,Z_DEFAULT_COMPRESSION);
+                CHECK(result == Z_OK,"zlib compression failed");
+                m_os.write(reinterpret_cast<const char*>(compressed.data()),compressed_bytes);
+                header[3+b] = compressed_bytes;
+            }
+            const std::streampos end = m_os.tellp();
+            m_os.seekp(header_position);
+            m_os.write(reinterpret_cast<const char*>(header.data()),
+                       header.size()*sizeof(uint64_t));
+            m_os.seekp(end);
+#endif
+        }
+    }
+
+    std::ostream& m_os;
+    bool m_compress;
+    std::vector<const vtu_array*> m_arrays;
+    std::vector<std::streampos> m_offset_positions;
+};
+
+}
+
+/// write the particles in \p particles to the VTK unstructured grid file
+/// \p filename (which should have the extension .vtu), without needing 
+/// the VTK library. 
+///
+/// The data is written in VTK's appended binary format, streaming each 
+/// variable in blocks directly from its column, so no intermediate grid 
+/// is built. All arithmetic and Vector variables are written in their 
+/// native precision, and each particle is written as a vertex cell. 
+/// If \p compress is true and Aboria was built with zlib (HAVE_ZLIB), 
+/// each block is compressed. 
+/// \see write_pvtu()
+template <typename ParticlesType>
+void write_vtu(const ParticlesType& particles, const std::string& filename, 
+               bool compress = false) {
+#ifndef HAVE_ZLIB
+    if (compress) {
+        LOG(1,"write_vtu: warning, Aboria was built without zlib, writing uncompressed data");
+        compress = false;
+    }
+#endif
+    const size_t n = particles.size();
+    LOG(2,"write_vtu: writing "<<n<<" particles to "<<filename);
+    std::ofstream os(filename,std::ios::binary);
+    CHECK(os,"could not open "<<filename<<" for writing");
+
+    const std::vector<detail::vtu_array> point_data = detail::get_vtu_point_data(particles);
+    const detail::vtu_array points = detail::get_vtu_points(particles);
+    const detail::vtu_array connectivity = 
+        detail::make_generated_vtu_array<int64_t>("connectivity",n,
+                [](size_t i) { return int64_t(i); });
+    const detail::vtu_array offsets = 
+        detail::make_generated_vtu_array<int64_t>("offsets",n,
+                [](size_t i) { return int64_t(i+1); });
+    // VTK_VERTEX == 1
+    const detail::vtu_array types = 
+        detail::make_generated_vtu_array<uint8_t>("types",n,
+                [](size_t) { return uint8_t(1); });
+
+    detail::vtu_appended_data appended(os,compress);
+    os << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"" 
+       << detail::vtk_byte_order() << "\" header_type=\"UInt64\"";
+    if (compress) {
+        os << " compressor=\"vtkZLibDataCompressor\"";
+    }
+    os << ">\n<UnstructuredGrid>\n"
+       << "<Piece NumberOfPoints=\"" << n << "\" NumberOfCells=\"" << n << "\">\n"
+       << "<PointData>\n";
+    for (const detail::vtu_array& array: point_data) {
+        appended.declare(array);
+    }
+    os << "</PointData>\n<Points>\n";
+    appended.declare(points);
+    os << "</Points>\n<Cells>\n";
+    appended.declare(connectivity);
+    appended.declare(offsets);
+    appended.declare(types);
+    os << "</Cells>\n</Piece>\n</UnstructuredGrid>\n"
+       << "<AppendedData encoding=\"raw\">\n_";
+    appended.write();
+    os << "\n</AppendedData>\n</VTKFile>\n";
+    CHECK(os,"error writing "<<filename);
+}
+
+/// write a parallel VTK unstructured grid file \p filename (which should 
+/// have the extension .pvtu) that combines the pieces \p pieces, each of
+/// which has been written using write_vtu() from a container of the same 
+/// type as \p particles
+/// \see write_vtu()
+template <typename ParticlesType>
+void write_pvtu(const ParticlesType& particles, const std::string& filename, 
+                const std::vector<std::string>& pieces) {
+    std::ofstream os(filename);
+    CHECK(os,"could not open "<<filename<<" for writing");
+
+    const std::vector<detail::vtu_array> point_data = detail::get_vtu_point_data(particles);
+    const detail::vtu_array points = detail::get_vtu_points(particles);
+
+    os << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\"" 
+       << detail::vtk_byte_order() << "\" header_type=\"UInt64\">\n"
+       << "<PUnstructuredGrid GhostLevel=\"0\">\n<PPointData>\n";
+    for (const detail::vtu_array& array: point_data) {
+        os << "<PDataArray type=\"" << array.type 
+           << "\" Name=\"" << detail::xml_escape(array.name)
+           << "\" NumberOfComponents=\"" << array.ncomponents << "\"/>\n";
+    }
+    os << "</PPointData>\n<PPoints>\n"
+       << "<PDataArray type=\"" << points.type << "\" NumberOfComponents=\"3\"/>\n"
+       << "</PPoints>\n";
+    for (const std::string& piece: pieces) {
+        os << "<Piece Source=\"" << detail::xml_escape(piece) << "\"/>\n";
+    }
+    os << "</PUnstructuredGrid>\n</VTKFile>\n";
+    CHECK(os,"error writing "<<filename);
+}
+
+}
+
+#endif /* VTU_WRITER_H_ */
@@ -39,10 +39,54 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define CONTEXTS_DETAIL_H_
 
 #include "detail/Symbolic.h"
+#include "Profile.h"
 
 namespace Aboria {
+
+// defined in Functions.h
+struct norm_fun;
+
 namespace detail {
 
+    // number of particles reduced serially by each task of a global
+    // reduction, see EvalCtx::sum_impl
+    const size_t reduce_chunk_size = 1024;
+
+
+    // Draws normally distributed variates for the evaluation contexts. The
+    // variates are generated in pairs with the Box-Muller transform, and the
+    // second of each pair is kept for the next draw from the same generator, 
+    // so each particle that needs several variates (e.g. 
+    // vector(N[a],N[a],N[a])) uses half the random numbers of independent
+    // draws, with no rejection loop
+    struct normal_pairs {
+        normal_pairs():m_generator(nullptr) {}
+
+        double operator()(generator_type& gen) {
+            if (m_generator == &gen) {
+                m_generator = nullptr;
+                return m_spare;
+            }
+            const double two_pi = 6.283185307179586;
+            std::uniform_real_distribution<double> uniform;
+            const double r = std::sqrt(-2.0*std::log(1.0-uniform(gen)));
+            const double theta = two_pi*uniform(gen);
+            m_spare = r*std::sin(theta);
+            m_generator = &gen;
+            return r*std::cos(theta);
+        }
+
+        generator_type* m_generator;
+        double m_spare;
+    };
+
+    inline double draw_random(const normal&, generator_type& gen, normal_pairs& normals) {
+        return normals(gen);
+    }
+
+    inline double draw_random(const uniform& u, generator_type& gen, normal_pairs&) {
+        return u(gen);
+    }
 
     ////////////////
     /// Contexts ///
@@ -60,7 +104,7 @@ namespace detail {
         static_assert(dx_size_type::value==dx_size,"dx size not consitent with labels_size");
         
         EvalCtx(labels_type labels=fusion::nil_(), dx_type dx=fusion::nil())
-            : m_labels(labels),m_dx(dx)
+            : m_labels(labels),m_dx(dx),m_norm_dx_valid(false)
         {}
 
         template<
@@ -110,14 +154,15 @@ namespace detail {
 
             result_type operator ()(Expr &expr, EvalCtx const &ctx) const
             {
-                // Normal and uniform terminal types have a operator() that takes a generator.
-                // Pass the random generator for the labeled particle to this operator()
-                return proto::value(proto::child_c<0>(expr))( 
+                // Pass the random generator for the labeled particle to the 
+                // normal or uniform terminal
+                return draw_random(proto::value(proto::child_c<0>(expr)), 
                         // need to const_cast this cause everything is
                         // normally held as a const &. Could cause problems???
                         const_cast<generator_type&>(get<random>(
                                 fusion::at_key<label_type>(ctx.m_labels)
-                                ))
+                                )),
+                        ctx.m_normals
                         );
             }
         };
@@ -189,6 +234,28 @@ namespace detail {
             }
         };
 
+        // Handle norm(dx) here. The norm is calculated once for each pair of
+        // particles and reused, as it often appears several times (e.g. in
+        // the condition, the kernel and the kernel's derivative)
+        template<typename Expr>
+        struct eval<Expr, proto::tag::function, 
+        typename boost::enable_if<
+            mpl::and_<
+                proto::matches<Expr, proto::function<proto::terminal<norm_fun>,
+                                                     proto::terminal<dx<_,_>>>>,
+                mpl::equal<size_type,mpl::int_<2>>
+        >>::type> {
+            typedef double result_type;
+
+            result_type operator ()(Expr &, EvalCtx const &ctx) const {
+                if (!ctx.m_norm_dx_valid) {
+                    ctx.m_norm_dx = fusion::front(ctx.m_dx).norm();
+                    ctx.m_norm_dx_valid = true;
+                }
+                return ctx.m_norm_dx;
+            }
+        };
+
         template <typename result_type,
                  typename label_type,
                  typename if_expr_type, 
@@ -204,13 +271,41 @@ namespace detail {
                 accumulate_type& accum,
                 const EvalCtx& ctx,mpl::int_<0>) { //note: using tag dispatching here cause I couldn't figure out how to do this via enable_if....
 
-            result_type sum = accum.init;
-            for (const auto& i: label.get_particles()) {
-                auto new_labels = fusion::make_map<label_type>(i);
-                EvalCtx<decltype(new_labels),decltype(ctx.m_dx)> const new_ctx(new_labels,ctx.m_dx);
+            // reduce over fixed size chunks of particles in parallel, then
+            // combine the chunks in order. The chunks do not depend on the
+            // number of threads, so the result is deterministic
+            ABORIA_PROFILE_ONLY(profile_statement<> profile("reduce");)
+            const auto& particles = label.get_particles();
+            const size_t n = particles.size();
+            const size_t nchunks = (n + reduce_chunk_size - 1)/reduce_chunk_size;
+            std::vector<result_type> chunk_sums(nchunks);
+            std::vector<char> chunk_found(nchunks,false);
+
+            #pragma omp parallel for
+            for (size_t chunk=0; chunk<nchunks; ++chunk) {
+                const size_t end = std::min(n,(chunk+1)*reduce_chunk_size);
+                ABORIA_PROFILE_ONLY(size_t accepted = 0;)
+                for (size_t i=chunk*reduce_chunk_size; i<end; ++i) {
+                    auto new_labels = fusion::make_map<label_type>(particles[i]);
+                    EvalCtx<decltype(new_labels),decltype(ctx.m_dx)> const new_ctx(new_labels,ctx.m_dx);
 
-                if (proto::eval(if_expr,new_ctx)) {
-                    sum = accum.functor(sum,proto::eval(expr,new_ctx));
+                    if (proto::eval(if_expr,new_ctx)) {
+                        ABORIA_PROFILE_ONLY(++accepted;)
+                        if (chunk_found[chunk]) {
+                            chunk_sums[chunk] = accum.functor(chunk_sums[chunk],proto::eval(expr,new_ctx));
+                        } else {
+                            chunk_sums[chunk] = proto::eval(expr,new_ctx);
+                            chunk_found[chunk] = true;
+                        }
+                    }
+                }
+                ABORIA_PROFILE_ONLY(profile_pairs(end-chunk*reduce_chunk_size,accepted,accepted);)
+            }
+
+            result_type sum = accum.init;
+            for (size_t chunk=0; chunk<nchunks; ++chunk) {
+                if (chunk_found[chunk]) {
+                    sum = accum.functor(sum,chunk_sums[chunk]);
                 }
             }
             return sum;
@@ -233,7 +328,7 @@ namespace detail {
 
             typedef typename label_b_type::particles_type particles_b_type;
             typedef typename particles_b_type::position position;
-            typedef typename position::value_type double_d;
+            typedef typename particles_b_type::double_d double_d;
             typedef typename std::remove_reference<
                 typename fusion::result_of::at_c<labels_type,0>::type>::type::first_type label_a_type;
             typedef typename label_a_type::particles_type particles_a_type;
@@ -255,27 +350,35 @@ namespace detail {
             if (is_trivially_true(if_expr)) {
                 for (size_t i=0; i<nb; ++i) {
                     const_b_reference bi = particlesb[i];
+                    const double_d dx = double_d(get<position>(bi))
+                                            -double_d(get<position>(ai));
 
                     EvalCtx<map_type,list_type> const new_ctx(
                             fusion::make_map<label_a_type,label_b_type>(ai,bi),
-                            fusion::make_list(get<position>(bi)-get<position>(ai))
+                            fusion::make_list(boost::cref(dx))
                             );
 
                     sum = accum.functor(sum,proto::eval(expr,new_ctx));
                 }
+                ABORIA_PROFILE_ONLY(profile_pairs(nb,nb,nb);)
             } else {
+                ABORIA_PROFILE_ONLY(size_t accepted = 0;)
                 for (size_t i=0; i<nb; ++i) {
                     const_b_reference bi = particlesb[i];
+                    const double_d dx = double_d(get<position>(bi))
+                                            -double_d(get<position>(ai));
 
                     EvalCtx<map_type,list_type> const new_ctx(
                             fusion::make_map<label_a_type,label_b_type>(ai,bi),
-                            fusion::make_list(get<position>(bi)-get<position>(ai))
+                            fusion::make_list(boost::cref(dx))
                             );
 
                     if (proto::eval(if_expr,new_ctx)) {
+                        ABORIA_PROFILE_ONLY(++accepted;)
                         sum = accum.functor(sum,proto::eval(expr,new_ctx));
                     }
                 }
+                ABORIA_PROFILE_ONLY(profile_pairs(nb,accepted,accepted);)
             }
             return sum;
         }
@@ -303,7 +406,7 @@ namespace detail {
                 typename fusion::result_of::at_c<labels_type,0>::type>::type::first_type label_a_type;
             typedef typename label_a_type::particles_type particles_a_type;
             typedef typename particles_a_type::position position;
-            typedef typename position::value_type double_d;
+            typedef typename particles_a_type::double_d double_d;
             typedef typename particles_a_type::const_reference const_a_reference;
             typedef typename particles_b_type::const_reference const_b_reference;
             
@@ -315,21 +418,25 @@ namespace detail {
             typedef fusion::list<const double_d &> list_type;
 
             result_type sum = accum.init;
+            ABORIA_PROFILE_ONLY(size_t candidates = 0; size_t accepted = 0;)
             //TODO: get query range and put it in box search
             for (const auto& i: box_search(particlesb.get_query(),get<position>(ai))) {
+                ABORIA_PROFILE_ONLY(++candidates;)
                 const_b_reference bi = std::get<0>(i);
                 const double_d& dx = std::get<1>(i);
 
                 EvalCtx<map_type,list_type> const new_ctx(
                         fusion::make_map<label_a_type,label_b_type>(ai,bi),
-                        fusion::make_list(dx)
+                        fusion::make_list(boost::cref(dx))
                         );
 
                 if (proto::eval(if_expr,new_ctx)) {
+                    ABORIA_PROFILE_ONLY(++accepted;)
                     sum = accum.functor(sum,proto::eval(expr,new_ctx));
                     
                 }
             }
+            ABORIA_PROFILE_ONLY(profile_pairs(candidates,accepted,accepted);)
             return sum;
         }
 
@@ -354,6 +461,80 @@ namespace detail {
 
         labels_type m_labels;
         dx_type m_dx;
+        mutable double m_norm_dx;
+        mutable bool m_norm_dx_valid;
+        mutable normal_pairs m_normals;
+};
+
+    // An evaluation context for univariate expressions that reads the
+    // variables of particle \p index directly from the columns of the
+    // particle container, rather than through a particle reference. This
+    // keeps the evaluation simple enough for the compiler to vectorise
+    // loops over \p index.
+    template<typename particles_type>
+    struct ColumnEvalCtx {
+        ColumnEvalCtx(const particles_type& particles, const size_t index)
+            : m_particles(particles),m_index(index)
+        {}
+
+        template<
+            typename Expr
+            , typename Tag = typename proto::tag_of<Expr>::type
+            , typename Enable = void
+            >
+        struct eval: proto::default_eval<Expr, ColumnEvalCtx const>
+        {};
+
+        // Handle symbol subscripts here...
+        template<typename Expr>
+        struct eval<Expr, proto::tag::subscript,
+        typename boost::enable_if<
+            mpl::and_<
+                proto::matches<typename proto::result_of::child_c<Expr,1>::type,
+                    proto::terminal<label<_,_>>>,
+                proto::matches<typename proto::result_of::child_c<Expr,0>::type,
+                    proto::terminal<symbolic<_>>>
+            >>::type> {
+
+            typedef typename proto::result_of::child_c<Expr,0>::type child0_type;
+            typedef typename proto::result_of::value<child0_type>::type symbolic_type;
+            typedef typename symbolic_type::variable_type variable_type;
+            typedef const typename variable_type::value_type & result_type;
+
+            result_type operator ()(Expr &, ColumnEvalCtx const &ctx) const {
+                return get<variable_type>(ctx.m_particles)[ctx.m_index];
+            }
+        };
+
+        // Handle normal and uniform subscripts here, using the random
+        // generator of particle \p index
+        template<typename Expr>
+        struct eval<Expr, proto::tag::subscript,
+        typename boost::enable_if<
+            mpl::and_<
+                proto::matches<typename proto::result_of::child_c<Expr,1>::type,
+                    proto::terminal<label<_,_>>>,
+                mpl::or_<
+                    proto::matches<typename proto::result_of::child_c<Expr,0>::type,
+                        proto::terminal<normal>>, 
+                    proto::matches<typename proto::result_of::child_c<Expr,0>::type,
+                        proto::terminal<uniform>> 
+                        >
+            >>::type> {
+
+            typedef double result_type;
+
+            result_type operator ()(Expr &expr, ColumnEvalCtx const &ctx) const {
+                return draw_random(proto::value(proto::child_c<0>(expr)), 
+                        const_cast<generator_type&>(
+                            get<random>(ctx.m_particles)[ctx.m_index]),
+                        ctx.m_normals);
+            }
+        };
+
+        const particles_type& m_particles;
+        const size_t m_index;
+        mutable normal_pairs m_normals;
 };
 
 }
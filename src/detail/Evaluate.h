@@ -86,6 +86,109 @@ struct is_not_aliased
       >
 {};
 
+// matches expressions that do not read \p VariableType for any particle
+template <typename VariableType, typename LabelType>
+struct does_not_read
+    : proto::or_<
+        proto::and_<
+            proto::terminal<proto::_>
+            ,proto::not_<is_my_symbol<VariableType>>
+            ,proto::not_<
+                proto::and_<
+                    proto::if_<boost::is_same<VariableType,
+                                       typename LabelType::particles_type::position>()>
+                    , proto::terminal<dx<_,_>>
+                >
+             >
+          >
+        , proto::nary_expr< proto::_, proto::vararg<does_not_read<VariableType,LabelType>>>
+      >
+{};
+
+// matches expressions that do not use the neighbour search
+struct is_local
+    : proto::or_<
+        proto::and_<
+            proto::terminal<proto::_>
+            ,proto::not_<proto::terminal<dx<_,_>>>
+          >
+        , proto::and_<
+            proto::nary_expr< proto::_, proto::vararg<is_local>>
+            ,proto::not_<proto::function<proto::terminal<accumulate<_>>,_,_,_>>
+            ,proto::not_<proto::function<proto::terminal<geometries<_>>,_,_>>
+          >
+      >
+{};
+
+// matches expressions that can be evaluated using ColumnEvalCtx
+struct is_column_expr
+    : proto::or_<
+        proto::and_<
+            proto::terminal<proto::_>
+            ,proto::not_<proto::terminal<dx<_,_>>>
+          >
+        , proto::and_<
+            proto::nary_expr< proto::_, proto::vararg<is_column_expr>>
+            ,proto::not_<proto::function<proto::terminal<accumulate<_>>,_,_,_>>
+            ,proto::not_<proto::function<proto::terminal<geometries<_>>,_,_>>
+          >
+      >
+{};
+
+/// a symbolic assignment whose evaluation is deferred, so that it can be
+/// evaluated together with others by evaluate_fused
+template<typename VariableType, typename Functor, typename ExprRHS, typename LabelType>
+struct symbolic_assignment {
+    typedef VariableType variable_type;
+    typedef Functor functor_type;
+    typedef ExprRHS expr_type;
+    typedef LabelType label_type;
+
+    symbolic_assignment(ExprRHS const & expr, LabelType &label):
+        expr(expr),label(label) {}
+
+    ExprRHS expr;
+    LabelType& label;
+};
+
+// true if no statement in \p Statements reads \p VariableType through a
+// label other than \p LabelType
+template <typename VariableType, typename LabelType, typename... Statements>
+struct is_not_aliased_in_any: mpl::true_ {};
+
+template <typename VariableType, typename LabelType, typename Statement, typename... Statements>
+struct is_not_aliased_in_any<VariableType,LabelType,Statement,Statements...>:
+    mpl::and_<
+        proto::matches<typename Statement::expr_type,is_not_aliased<VariableType,LabelType>>
+        ,is_not_aliased_in_any<VariableType,LabelType,Statements...>
+    >
+{};
+
+// true if no statement in \p Statements reads or writes \p VariableType
+template <typename VariableType, typename LabelType, typename... Statements>
+struct is_not_used_in_any: mpl::true_ {};
+
+template <typename VariableType, typename LabelType, typename Statement, typename... Statements>
+struct is_not_used_in_any<VariableType,LabelType,Statement,Statements...>:
+    mpl::and_<
+        proto::matches<typename Statement::expr_type,does_not_read<VariableType,LabelType>>
+        ,mpl::not_<boost::is_same<typename Statement::variable_type,VariableType>>
+        ,is_not_used_in_any<VariableType,LabelType,Statements...>
+    >
+{};
+
+// true if no statement in \p Statements uses the neighbour search
+template <typename... Statements>
+struct is_local_in_all: mpl::true_ {};
+
+template <typename Statement, typename... Statements>
+struct is_local_in_all<Statement,Statements...>:
+    mpl::and_<
+        proto::matches<typename Statement::expr_type,is_local>
+        ,is_local_in_all<Statements...>
+    >
+{};
+
 // expose alias checking for testing in metafunctions.h
 template< typename SymbolType, typename LabelType, typename ExprRHS  > 
 typename boost::enable_if<
@@ -108,6 +211,53 @@ alias_check(SymbolType const &, LabelType const &, ExprRHS const &) {
     return mpl::false_();
 }
 
+/// returns the column of \p particles that evaluate_nonlinear writes to
+template <typename VariableType, typename ParticlesType, typename LabelType>
+std::vector<typename VariableType::value_type>& 
+get_evaluate_buffer(ParticlesType& particles, const LabelType&, std::true_type) {
+    return get<VariableType>(particles);
+}
+
+/// returns the tempory buffer held by \p label, used when evaluate_nonlinear
+/// cannot write directly to the particles' column
+template <typename VariableType, typename ParticlesType, typename LabelType>
+std::vector<typename VariableType::value_type>& 
+get_evaluate_buffer(ParticlesType&, const LabelType& label, std::false_type) {
+    return get<VariableType>(label.get_buffers());
+}
+
+// resizes a buffer returned by get_evaluate_buffer, growing its capacity
+// geometrically so that the buffers held by a label are rarely reallocated
+// as the number of particles changes
+template <typename T>
+void resize_evaluate_buffer(std::vector<T>& buffer, const size_t n) {
+    if (buffer.capacity() < n) {
+        buffer.reserve(std::max(n,2*buffer.capacity()));
+    }
+    buffer.resize(n);
+}
+
+// writes a buffer returned by get_evaluate_buffer back to the particles,
+// swapping it with the particles' column. The buffer then holds the old
+// values, ready to be reused by the next evaluation
+template <typename VariableType, typename ParticlesType>
+void copy_back_evaluate_buffer(ParticlesType& particles, 
+        std::vector<typename VariableType::value_type>& buffer, std::false_type) {
+    particles.template swap_variable<VariableType>(buffer);
+}
+
+// a ParticlesView does not own its columns, so copy the buffer back 
+// element by element
+template <typename VariableType, typename ParticlesType>
+void copy_back_evaluate_buffer(ParticlesType& particles, 
+        std::vector<typename VariableType::value_type>& buffer, std::true_type) {
+    const size_t n = particles.size();
+    #pragma omp parallel for
+    for (size_t i=0; i<n; i++) {
+        get<VariableType>(particles[i]) = buffer[i];
+    }
+}
+
 template< typename LabelType, typename ExprRHS>
 typename boost::enable_if<detail::is_univariate<ExprRHS>,void >::type
 check_valid_assign_expr(const LabelType& label, ExprRHS const & expr) {
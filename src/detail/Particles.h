@@ -42,6 +42,358 @@ namespace Aboria {
 
 namespace detail {
 
+/// magic number at the start of a binary checkpoint file
+static const char checkpoint_magic[8] = {'A','B','O','R','I','A','C','P'};
+
+/// version of the binary checkpoint format
+static const uint32_t checkpoint_version = 2;
+
+/// the data of each column in a checkpoint starts at a multiple of this 
+/// number of bytes from the start of the file, so that it can be mapped
+static const size_t checkpoint_alignment = 64;
+
+/// true if a column of type T can be written and read as raw bytes. 
+/// Vector and the random generator are not trivially copyable in the 
+/// strict sense (they have user-provided copy operations), but hold only 
+/// plain data
+template <typename T>
+struct is_bitwise_serializable: 
+    std::integral_constant<bool,std::is_trivially_copyable<T>::value> {};
+
+template <typename T, unsigned int N>
+struct is_bitwise_serializable<Vector<T,N>>: is_bitwise_serializable<T> {};
+
+template <>
+struct is_bitwise_serializable<generator_type>: std::true_type {};
+
+template <typename T>
+void write_binary(std::ostream& os, const T& value) {
+    os.write(reinterpret_cast<const char*>(&value),sizeof(T));
+}
+
+template <typename T>
+void read_binary(std::istream& is, T& value) {
+    is.read(reinterpret_cast<char*>(&value),sizeof(T));
+}
+
+inline void write_binary_string(std::ostream& os, const std::string& value) {
+    write_binary(os,uint32_t(value.size()));
+    os.write(value.data(),value.size());
+}
+
+inline void read_binary_string(std::istream& is, std::string& value) {
+    uint32_t n;
+    read_binary(is,n);
+    value.resize(n);
+    is.read(&value[0],n);
+}
+
+/// the number of padding bytes needed to align \p position
+inline size_t checkpoint_padding(const std::streamoff position) {
+    CHECK(position >= 0,"checkpoints require a seekable stream");
+    return (checkpoint_alignment - position % checkpoint_alignment) % checkpoint_alignment;
+}
+
+/// the header of a binary checkpoint file
+template <unsigned int D>
+struct checkpoint_header {
+    typedef Vector<double,D> double_d;
+    typedef Vector<bool,D> bool_d;
+
+    uint32_t version;
+    uint32_t dimension;
+    uint32_t ncolumns;
+    uint64_t n;
+    uint64_t next_id;
+    uint32_t seed;
+    uint8_t searchable;
+    double_d low;
+    double_d high;
+    bool_d periodic;
+    double_d nbuckets;
+
+    checkpoint_header():
+        version(checkpoint_version),
+        dimension(D),
+        ncolumns(0),
+        n(0),
+        next_id(0),
+        seed(0),
+        searchable(false),
+        low(0),
+        high(0),
+        periodic(false),
+        nbuckets(0)
+    {}
+
+    void write(std::ostream& os) const {
+        os.write(checkpoint_magic,sizeof(checkpoint_magic));
+        write_binary(os,version);
+        write_binary(os,dimension);
+        write_binary(os,ncolumns);
+        write_binary(os,n);
+        write_binary(os,next_id);
+        write_binary(os,seed);
+        write_binary(os,searchable);
+        for (size_t i=0; i<D; ++i) {
+            write_binary(os,low[i]);
+            write_binary(os,high[i]);
+            write_binary(os,uint8_t(periodic[i]));
+            write_binary(os,uint32_t(nbuckets[i]));
+        }
+    }
+
+    void read(std::istream& is) {
+        char magic[sizeof(checkpoint_magic)];
+        is.read(magic,sizeof(magic));
+        CHECK(is && std::equal(magic,magic+sizeof(magic),checkpoint_magic),
+                "stream is not an Aboria checkpoint");
+        read_binary(is,version);
+        CHECK(version == checkpoint_version,"unsupported checkpoint version "<<version);
+        read_binary(is,dimension);
+        read_binary(is,ncolumns);
+        read_binary(is,n);
+        read_binary(is,next_id);
+        read_binary(is,seed);
+        read_binary(is,searchable);
+        for (size_t i=0; i<D && i<dimension; ++i) {
+            uint8_t p;
+            uint32_t nb;
+            read_binary(is,low[i]);
+            read_binary(is,high[i]);
+            read_binary(is,p);
+            read_binary(is,nb);
+            periodic[i] = p;
+            nbuckets[i] = nb;
+        }
+        CHECK(is,"error reading checkpoint header");
+    }
+};
+
+/// reads the name and element size of a column of Variable type \p V, 
+/// checks that they match, and skips the padding before the column data
+template <typename V>
+void read_column_header(std::istream& is) {
+    typedef typename V::value_type value_type;
+    std::string name;
+    uint32_t element_size;
+    read_binary_string(is,name);
+    read_binary(is,element_size);
+    CHECK(name == V().name,"checkpoint has variable "<<name<<" where "<<V().name<<" was expected");
+    CHECK(element_size == sizeof(value_type),"checkpoint variable "<<name<<" has element size "<<element_size<<" != "<<sizeof(value_type));
+    is.ignore(checkpoint_padding(is.tellg()));
+}
+
+/// writes each column of a particle container to a binary stream, preceded 
+/// by the name of the variable and the size of its elements. The column
+/// is written directly from its contiguous storage
+template <typename DataType>
+struct write_column {
+    typedef typename DataType::mpl_type_vector mpl_type_vector;
+
+    write_column(std::ostream& os, const DataType& data):
+        os(os),data(data) {}
+
+    template< typename U > 
+    void operator()(U) {
+        typedef typename mpl::at<mpl_type_vector,U>::type variable_type;
+        typedef typename variable_type::value_type value_type;
+        static_assert(is_bitwise_serializable<value_type>::value,
+                "binary checkpoints require trivially copyable variables");
+        const auto& column = get<variable_type>(data);
+        write_binary_string(os,variable_type().name);
+        write_binary(os,uint32_t(sizeof(value_type)));
+        const char padding[checkpoint_alignment] = {};
+        os.write(padding,checkpoint_padding(os.tellp()));
+        os.write(reinterpret_cast<const char*>(column.data()),
+                 column.size()*sizeof(value_type));
+    }
+
+    std::ostream& os;
+    const DataType& data;
+};
+
+/// reads each column of a particle container from a binary stream written
+/// by write_column. The columns must already be the correct size
+template <typename DataType>
+struct read_column {
+    typedef typename DataType::mpl_type_vector mpl_type_vector;
+
+    read_column(std::istream& is, DataType& data):
+        is(is),data(data) {}
+
+    template< typename U > 
+    void operator()(U) {
+        typedef typename mpl::at<mpl_type_vector,U>::type variable_type;
+        typedef typename variable_type::value_type value_type;
+        static_assert(is_bitwise_serializable<value_type>::value,
+                "binary checkpoints require trivially copyable variables");
+        read_column_header<variable_type>(is);
+        auto& column = get<variable_type>(data);
+        is.read(reinterpret_cast<char*>(column.data()),
+                column.size()*sizeof(value_type));
+        CHECK(is,"error reading variable "<<variable_type().name<<" from checkpoint");
+    }
+
+    std::istream& is;
+    DataType& data;
+};
+
+#ifndef _WIN32
+/// maps each column of a particle container from a checkpoint file, using
+/// \p is to find the position of each column in the file. The columns must
+/// be of type mmap_vector
+template <typename DataType>
+struct map_column {
+    typedef typename DataType::mpl_type_vector mpl_type_vector;
+
+    map_column(std::istream& is, DataType& data, 
+               const std::shared_ptr<mmap_region>& region, const size_t n):
+        is(is),data(data),region(region),n(n) {}
+
+    template< typename U > 
+    void operator()(U) {
+        typedef typename mpl::at<mpl_type_vector,U>::type variable_type;
+        typedef typename variable_type::value_type value_type;
+        static_assert(is_bitwise_serializable<value_type>::value,
+                "binary checkpoints require trivially copyable variables");
+        read_column_header<variable_type>(is);
+        const std::streamoff offset = is.tellg();
+        get<variable_type>(data).map(region,offset,n);
+        is.seekg(n*sizeof(value_type),std::ios::cur);
+        CHECK(is,"error mapping variable "<<variable_type().name<<" from checkpoint");
+    }
+
+    std::istream& is;
+    DataType& data;
+    const std::shared_ptr<mmap_region>& region;
+    size_t n;
+};
+#endif
+
+/// describes where one field of an input record is stored. A null \p parse
+/// means the field is ignored
+struct ingest_field {
+    /// the location of the field for the first new particle
+    char* data;
+    /// the number of bytes between consecutive particles
+    size_t stride;
+    /// the number of bytes in the field
+    size_t size;
+    /// parse the text at \p text and store the value at \p dest
+    void (*parse)(const char* text, char* dest);
+};
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type
+parse_ingest_value(const char* text, char* dest) {
+    *reinterpret_cast<T*>(dest) = static_cast<T>(std::strtod(text,nullptr));
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+parse_ingest_value(const char* text, char* dest) {
+    *reinterpret_cast<T*>(dest) = static_cast<T>(std::strtoll(text,nullptr,10));
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+parse_ingest_value(const char* text, char* dest) {
+    *reinterpret_cast<T*>(dest) = static_cast<T>(std::strtoull(text,nullptr,10));
+}
+
+/// for each arithmetic or Vector variable (except id, alive and random), 
+/// sets the ingest_field for the input field with the same name as the 
+/// variable. A component d of a Vector variable is matched by the name
+/// followed by "_d", e.g. "position_0"
+template <typename ParticlesType>
+struct set_ingest_fields {
+    typedef typename ParticlesType::mpl_type_vector mpl_type_vector;
+    template <typename U>
+    using variable_type = typename mpl::at<mpl_type_vector,U>::type;
+    template <typename U>
+    using value_type = typename variable_type<U>::value_type;
+    template <typename U>
+    using is_generated = mpl::or_<boost::is_same<variable_type<U>,id>,
+                                  boost::is_same<variable_type<U>,alive>,
+                                  boost::is_same<variable_type<U>,Aboria::random>>;
+
+    set_ingest_fields(ParticlesType& particles, const size_t start, 
+                      const std::vector<std::string>& names, 
+                      std::vector<ingest_field>& fields):
+        particles(particles),start(start),names(names),fields(fields) {}
+
+    template< typename U > 
+    typename boost::enable_if<mpl::and_<boost::is_arithmetic<value_type<U>>,
+                                        mpl::not_<is_generated<U>>>>::type
+    operator()(U) {
+        typedef value_type<U> T;
+        char* data = reinterpret_cast<char*>(
+                get<variable_type<U>>(particles).data() + start);
+        set(variable_type<U>().name,data,sizeof(T),sizeof(T),
+            &parse_ingest_value<T>);
+    }
+
+    template< typename U > 
+    typename boost::enable_if<is_vector<value_type<U>>>::type
+    operator()(U) {
+        typedef typename value_type<U>::value_type T;
+        char* data = reinterpret_cast<char*>(
+                get<variable_type<U>>(particles).data() + start);
+        for (size_t d=0; d<value_type<U>::size; ++d) {
+            set(std::string(variable_type<U>().name)+"_"+std::to_string(d),
+                data+d*sizeof(T),sizeof(value_type<U>),sizeof(T),
+                &parse_ingest_value<T>);
+        }
+    }
+
+    template< typename U > 
+    typename boost::enable_if<mpl::or_<is_generated<U>,
+                                       mpl::and_<mpl::not_<boost::is_arithmetic<value_type<U>>>,
+                                                 mpl::not_<is_vector<value_type<U>>>>>>::type
+    operator()(U) {}
+
+    void set(const std::string& name, char* data, const size_t stride, 
+             const size_t size, void (*parse)(const char*, char*)) {
+        for (size_t k=0; k<names.size(); ++k) {
+            if (names[k] == name) {
+                fields[k] = ingest_field{data,stride,size,parse};
+            }
+        }
+    }
+
+    ParticlesType& particles;
+    size_t start;
+    const std::vector<std::string>& names;
+    std::vector<ingest_field>& fields;
+};
+
+/// returns the ingest_field for each of the input fields named \p names, 
+/// storing the new particles from index \p start in \p particles
+template <typename ParticlesType>
+std::vector<ingest_field> get_ingest_fields(ParticlesType& particles, 
+        const size_t start, const std::vector<std::string>& names) {
+    typedef typename ParticlesType::mpl_type_vector mpl_type_vector;
+    std::vector<ingest_field> fields(names.size(),ingest_field{nullptr,0,0,nullptr});
+    mpl::for_each<mpl::range_c<int,0,mpl::size<mpl_type_vector>::type::value>>(
+            set_ingest_fields<ParticlesType>(particles,start,names,fields));
+    return fields;
+}
+
+/// split \p line at each \p delimiter, removing surrounding whitespace
+inline std::vector<std::string> split_csv_line(const std::string& line, const char delimiter) {
+    std::vector<std::string> fields;
+    std::istringstream ss(line);
+    std::string field;
+    while (std::getline(ss,field,delimiter)) {
+        const size_t first = field.find_first_not_of(" \t\r");
+        const size_t last = field.find_last_not_of(" \t\r");
+        fields.push_back(first == std::string::npos ? 
+                            "" : field.substr(first,last-first+1));
+    }
+    return fields;
+}
+
 #ifdef HAVE_VTK
 template <typename reference>
 struct write_from_tuple {
@@ -181,6 +533,70 @@ struct setup_datas_for_reading {
     vtkUnstructuredGrid *grid;
 };
 
+
+/// adds a VTK array to \p point_data that refers to (rather than copies) 
+/// each arithmetic or Vector column of \p particles. VTK does not 
+/// take ownership of the column data, so the arrays are only valid until
+/// the columns are next reallocated. The columns are read through the 
+/// const accessors, so wrapping them does not mark them as changed
+template <typename ParticlesType>
+struct wrap_columns_in_vtk_arrays {
+    typedef typename ParticlesType::mpl_type_vector mpl_type_vector;
+    template <typename U>
+    using value_type = typename mpl::at<mpl_type_vector,U>::type::value_type;
+    template <typename T>
+    using is_vtk_value = mpl::bool_<boost::is_arithmetic<T>::value 
+                                    && !boost::is_same<T,bool>::value>;
+
+    wrap_columns_in_vtk_arrays(const ParticlesType& particles, vtkPointData* point_data):
+        particles(particles),point_data(point_data) {}
+
+    template< typename U > 
+    typename boost::enable_if<is_vtk_value<value_type<U>>>::type
+    operator()(U) {
+        typedef typename mpl::at<mpl_type_vector,U>::type variable_type;
+        wrap<value_type<U>>(variable_type().name,
+                            get<variable_type>(particles).data(),1);
+    }
+
+    template< typename U > 
+    typename boost::enable_if<mpl::and_<is_vector<value_type<U>>,
+                                        is_vtk_value<typename value_type<U>::value_type>>>::type
+    operator()(U) {
+        typedef typename mpl::at<mpl_type_vector,U>::type variable_type;
+        typedef typename value_type<U>::value_type element_type;
+        wrap<element_type>(variable_type().name,
+                reinterpret_cast<const element_type*>(get<variable_type>(particles).data()),
+                value_type<U>::size);
+    }
+
+    template< typename U > 
+    typename boost::disable_if<mpl::or_<is_vtk_value<value_type<U>>,
+                                        is_vector<value_type<U>>>>::type
+    operator()(U) {}
+
+    template< typename U > 
+    typename boost::enable_if<mpl::and_<is_vector<value_type<U>>,
+                                        mpl::not_<is_vtk_value<typename value_type<U>::value_type>>>>::type
+    operator()(U) {}
+
+    template <typename T>
+    void wrap(const char* name, const T* data, const int ncomponents) {
+        vtkSmartPointer<vtkAOSDataArrayTemplate<T>> array = 
+            vtkSmartPointer<vtkAOSDataArrayTemplate<T>>::New();
+        array->SetName(name);
+        array->SetNumberOfComponents(ncomponents);
+        // save = 1, VTK will not free the column. SetArray takes a 
+        // non-const pointer, but nothing in Aboria writes through the view
+        array->SetArray(const_cast<T*>(data),ncomponents*particles.size(),1);
+        // replaces any existing array with the same name
+        point_data->AddArray(array);
+    }
+
+    const ParticlesType& particles;
+    vtkPointData* point_data;
+};
+
 #endif
 
 }
@@ -103,7 +103,31 @@ namespace Aboria {
             DEFINE_THE_OP(std::divides<typename VariableType::value_type>,/=)
             DEFINE_THE_OP(std::multiplies<typename VariableType::value_type>,*=)
             DEFINE_THE_OP(detail::return_second,=)
-            
+
+            #undef DEFINE_THE_OP
+
+            // deferred versions of the assignment operators, for use with
+            // evaluate_fused
+            #define DEFINE_THE_DEFERRED_OP(functor,name) \
+            template< typename ExprRHS > \
+            symbolic_assignment<VariableType,functor, \
+                typename std::decay<typename proto::result_of::as_expr<ExprRHS const,SymbolicDomain>::type>::type, \
+                label_type> \
+            name (ExprRHS const & expr) const { \
+                BOOST_MPL_ASSERT_NOT(( boost::is_same<VariableType,id > )); \
+                return symbolic_assignment<VariableType,functor, \
+                    typename std::decay<typename proto::result_of::as_expr<ExprRHS const,SymbolicDomain>::type>::type, \
+                    label_type>(proto::as_expr<SymbolicDomain>(expr),mlabel); \
+            } \
+
+            DEFINE_THE_DEFERRED_OP(std::plus<typename VariableType::value_type>,plus_assign)
+            DEFINE_THE_DEFERRED_OP(std::minus<typename VariableType::value_type>,minus_assign)
+            DEFINE_THE_DEFERRED_OP(std::divides<typename VariableType::value_type>,divides_assign)
+            DEFINE_THE_DEFERRED_OP(std::multiplies<typename VariableType::value_type>,multiplies_assign)
+            DEFINE_THE_DEFERRED_OP(detail::return_second,assign)
+
+            #undef DEFINE_THE_DEFERRED_OP
+
 
             private:
 
@@ -0,0 +1,286 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+
+#ifndef TRAJECTORY_DETAIL_H_
+#define TRAJECTORY_DETAIL_H_
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+namespace Aboria {
+namespace detail {
+
+/// magic number at the start of a trajectory file
+static const char trajectory_magic[8] = {'A','B','O','R','I','A','T','J'};
+
+/// version of the trajectory file format
+static const uint32_t trajectory_version = 1;
+
+/// append \p value to \p out as a LEB128 variable length integer, so that
+/// small values take fewer bytes
+inline void write_varint(std::vector<char>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/// read a LEB128 variable length integer starting at \p in and advance
+/// \p in past it
+inline uint64_t read_varint(const char*& in) {
+    uint64_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = static_cast<uint8_t>(*in++);
+        value |= uint64_t(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/// map signed integers to unsigned so that small magnitudes give small
+/// values (0,-1,1,-2,... -> 0,1,2,3,...)
+inline uint64_t zigzag_encode(const int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(const uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/// converts between doubles and the integers that are delta encoded. If 
+/// \p tolerance is zero the integer is the bit pattern of the double, and
+/// deltas are taken with xor, so the data is stored losslessly. Otherwise
+/// the double is rounded to a multiple of tolerance, so the error is at
+/// most tolerance/2, and deltas are differences
+struct trajectory_quantiser {
+    trajectory_quantiser(const double tolerance):tolerance(tolerance) {}
+
+    int64_t quantise(const double value) const {
+        if (tolerance == 0) {
+            int64_t bits;
+            std::memcpy(&bits,&value,sizeof(double));
+            return bits;
+        } else {
+            return std::llround(value/tolerance);
+        }
+    }
+
+    double dequantise(const int64_t value) const {
+        if (tolerance == 0) {
+            double result;
+            std::memcpy(&result,&value,sizeof(double));
+            return result;
+        } else {
+            return value*tolerance;
+        }
+    }
+
+    uint64_t encode(const int64_t value, const int64_t previous) const {
+        if (tolerance == 0) {
+            return static_cast<uint64_t>(value ^ previous);
+        } else {
+            return zigzag_encode(value - previous);
+        }
+    }
+
+    int64_t decode(const uint64_t delta, const int64_t previous) const {
+        if (tolerance == 0) {
+            return static_cast<int64_t>(delta) ^ previous;
+        } else {
+            return zigzag_decode(delta) + previous;
+        }
+    }
+
+    double tolerance;
+};
+
+/// the particles in one frame, sorted by id. \p values holds 
+/// ncomponents quantised values for each particle
+struct trajectory_state {
+    std::vector<size_t> ids;
+    std::vector<int64_t> values;
+};
+
+/// encode \p current (relative to \p previous, which is empty for a 
+/// keyframe) into \p out. Particles are matched by id, and particles that
+/// are not in \p previous are encoded relative to zero
+inline void encode_trajectory_frame(const trajectory_state& current,
+                                    const trajectory_state& previous,
+                                    const size_t ncomponents,
+                                    const trajectory_quantiser& quantiser,
+                                    std::vector<char>& out) {
+    const size_t n = current.ids.size();
+    // index of each particle in the previous frame, or -1 if it is new
+    std::vector<int64_t> previous_index(n,-1);
+    size_t j = 0;
+    for (size_t i=0; i<n; ++i) {
+        while (j < previous.ids.size() && previous.ids[j] < current.ids[i]) ++j;
+        if (j < previous.ids.size() && previous.ids[j] == current.ids[i]) {
+            previous_index[i] = j;
+        }
+    }
+
+    size_t last_id = 0;
+    for (size_t i=0; i<n; ++i) {
+        write_varint(out,current.ids[i]-last_id);
+        last_id = current.ids[i];
+    }
+    // component-major order keeps similar deltas together
+    for (size_t c=0; c<ncomponents; ++c) {
+        for (size_t i=0; i<n; ++i) {
+            const int64_t prev = previous_index[i] < 0 ? 
+                0 : previous.values[previous_index[i]*ncomponents+c];
+            write_varint(out,quantiser.encode(current.values[i*ncomponents+c],prev));
+        }
+    }
+}
+
+/// the inverse of encode_trajectory_frame
+inline void decode_trajectory_frame(const char* in, const size_t n,
+                                    const trajectory_state& previous,
+                                    const size_t ncomponents,
+                                    const trajectory_quantiser& quantiser,
+                                    trajectory_state& current) {
+    current.ids.resize(n);
+    current.values.resize(n*ncomponents);
+    size_t last_id = 0;
+    for (size_t i=0; i<n; ++i) {
+        last_id += read_varint(in);
+        current.ids[i] = last_id;
+    }
+    std::vector<int64_t> previous_index(n,-1);
+    size_t j = 0;
+    for (size_t i=0; i<n; ++i) {
+        while (j < previous.ids.size() && previous.ids[j] < current.ids[i]) ++j;
+        if (j < previous.ids.size() && previous.ids[j] == current.ids[i]) {
+            previous_index[i] = j;
+        }
+    }
+    for (size_t c=0; c<ncomponents; ++c) {
+        for (size_t i=0; i<n; ++i) {
+            const int64_t prev = previous_index[i] < 0 ? 
+                0 : previous.values[previous_index[i]*ncomponents+c];
+            current.values[i*ncomponents+c] = quantiser.decode(read_varint(in),prev);
+        }
+    }
+}
+
+/// the number of components of a variable with value type T
+template <typename T>
+struct trajectory_components: std::integral_constant<unsigned int,1> {
+    static_assert(std::is_arithmetic<T>::value,
+            "trajectory variables must be arithmetic or Vector");
+};
+
+template <typename T, unsigned int N>
+struct trajectory_components<Vector<T,N>>: std::integral_constant<unsigned int,N> {};
+
+template <typename T>
+double trajectory_component(const T& value, const unsigned int) {
+    return value;
+}
+
+template <typename T, unsigned int N>
+double trajectory_component(const Vector<T,N>& value, const unsigned int c) {
+    return value[c];
+}
+
+/// adds the name and number of components of each variable
+struct get_trajectory_columns {
+    get_trajectory_columns(std::vector<std::string>& names, 
+                           std::vector<unsigned int>& ncomponents):
+        names(names),ncomponents(ncomponents) {}
+
+    template <typename Variable>
+    void operator()(Variable v) {
+        names.push_back(v.name);
+        ncomponents.push_back(
+                trajectory_components<typename Variable::value_type>::value);
+    }
+
+    std::vector<std::string>& names;
+    std::vector<unsigned int>& ncomponents;
+};
+
+/// quantises each variable of each particle into the rows of \p values, 
+/// in the order given by \p order
+template <typename ParticlesType>
+struct gather_trajectory_columns {
+    gather_trajectory_columns(const ParticlesType& particles, 
+                              const std::vector<size_t>& order,
+                              const size_t ncomponents,
+                              const trajectory_quantiser& quantiser,
+                              std::vector<int64_t>& values,
+                              size_t& offset):
+        particles(particles),order(order),ncomponents(ncomponents),
+        quantiser(quantiser),values(values),offset(offset) {}
+
+    template <typename Variable>
+    void operator()(Variable) {
+        typedef typename Variable::value_type value_type;
+        const unsigned int N = trajectory_components<value_type>::value;
+        const size_t n = order.size();
+        #pragma omp parallel for
+        for (size_t i=0; i<n; ++i) {
+            const value_type& value = get<Variable>(particles)[order[i]];
+            for (unsigned int c=0; c<N; ++c) {
+                values[i*ncomponents+offset+c] = 
+                    quantiser.quantise(trajectory_component(value,c));
+            }
+        }
+        offset += N;
+    }
+
+    const ParticlesType& particles;
+    const std::vector<size_t>& order;
+    size_t ncomponents;
+    const trajectory_quantiser& quantiser;
+    std::vector<int64_t>& values;
+    size_t& offset;
+};
+
+}
+}
+
+#endif
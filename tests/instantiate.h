@@ -0,0 +1,126 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef INSTANTIATE_TEST_H_ 
+#define INSTANTIATE_TEST_H_ 
+
+#include <cxxtest/TestSuite.h>
+
+#include "Aboria.h"
+
+namespace instantiate_test {
+using namespace Aboria;
+
+ABORIA_VARIABLE(scalar,double,"scalar")
+typedef Particles<std::tuple<scalar>,3,std::vector,bucket_search_serial> particles_serial;
+typedef Particles<std::tuple<scalar>,2,std::vector,bucket_search_parallel> particles_parallel;
+
+}
+
+// the members of these types are instantiated in instantiate.cpp, 
+// so they are only declared here
+ABORIA_EXTERN_PARTICLES(instantiate_test::particles_serial)
+ABORIA_EXTERN_PARTICLES(instantiate_test::particles_parallel)
+
+using namespace Aboria;
+
+class InstantiateTest: public CxxTest::TestSuite {
+public:
+    template<typename ParticlesType>
+    void helper_extern_particles(void) {
+        typedef typename ParticlesType::position position;
+        typedef typename ParticlesType::double_d double_d;
+        typedef typename ParticlesType::bool_d bool_d;
+        typedef instantiate_test::scalar scalar;
+        const unsigned int D = ParticlesType::dimension;
+
+        ParticlesType particles;
+        particles.init_neighbour_search(double_d(0),double_d(1),0.1,bool_d(false));
+        for (int i=0; i<10; ++i) {
+            typename ParticlesType::value_type p;
+            get<position>(p) = double_d(0.05+0.1*i);
+            get<scalar>(p) = i;
+            particles.push_back(p);
+        }
+        TS_ASSERT_EQUALS(particles.size(),10);
+
+        // erase the particle with id 3 and check that the rest can be found
+        particles.erase(particles.find(3));
+        TS_ASSERT_EQUALS(particles.size(),9);
+        for (size_t i=0; i<10; ++i) {
+            if (i == 3) {
+                TS_ASSERT(particles.find(i) == particles.end());
+            } else {
+                TS_ASSERT_EQUALS(get<scalar>(*particles.find(i)),double(i));
+            }
+        }
+
+        // each particle is diagonally adjacent to its neighbours in the line
+        const double radius = 0.1*std::sqrt(double(D))+1e-10;
+        particles.reset_neighbour_search(radius);
+        const ParticlesType& cparticles = particles;
+        for (size_t i=0; i<cparticles.size(); ++i) {
+            const size_t pid = get<id>(cparticles[i]);
+            int count = 0;
+            for (auto tpl: box_search(cparticles.get_query(),get<position>(cparticles[i]))) {
+                if (&get<position>(std::get<0>(tpl)) != &get<position>(cparticles[i]) 
+                        && std::get<1>(tpl).norm() <= radius) {
+                    ++count;
+                }
+            }
+            const int expected = (pid != 0 && pid != 4) + (pid != 9 && pid != 2);
+            TS_ASSERT_EQUALS(count,expected);
+        }
+
+        // write and read back a checkpoint
+        std::stringstream checkpoint;
+        particles.write_checkpoint(checkpoint);
+        ParticlesType particles2;
+        particles2.read_checkpoint(checkpoint);
+        TS_ASSERT_EQUALS(particles2.size(),particles.size());
+        for (size_t i=0; i<particles.size(); ++i) {
+            TS_ASSERT_EQUALS(get<id>(particles2[i]),get<id>(particles[i]));
+            TS_ASSERT_EQUALS(get<scalar>(particles2[i]),get<scalar>(particles[i]));
+        }
+    }
+
+    void test_extern_particles(void) {
+        helper_extern_particles<instantiate_test::particles_serial>();
+        helper_extern_particles<instantiate_test::particles_parallel>();
+    }
+};
+
+#endif /* INSTANTIATE_TEST_H_ */
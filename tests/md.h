@@ -152,7 +152,6 @@ public:
         /*
          * create symbols and labels in order to use the expression API
          */
-        Symbol<position> p;
         Symbol<velocity> v;
         Symbol<id> id_;
         Label<0,container_type> a(particles);
@@ -186,13 +185,12 @@ public:
                 /*
                  * leap frog integrator
                  */
-                v[a] += dt * ( 
+                leapfrog(a, v, dt, 
                         // spring force between particles
                         sum(b, id_[a]!=id_[b] && norm(dx)<diameter, 
                               -k*(diameter/norm(dx)-1)*dx)
                         /mass
                         );
-                p[a] += dt*v[a];
             }
         }
         std::cout << std::endl;
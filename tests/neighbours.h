@@ -249,6 +249,55 @@ For example,
     	TS_ASSERT_EQUALS(std::distance(tpl.begin(),tpl.end()),0);
     }
 
+    template<template <typename,typename> class Vector,template <typename> class SearchMethod>
+    void helper_float_positions(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+    	typedef Particles<std::tuple<scalar>,3,Vector,SearchMethod,
+                          Traits<Vector,float>> Test_type;
+        typedef typename Test_type::position position;
+        typedef Aboria::Vector<float,3> float3;
+        static_assert(std::is_same<typename position::value_type,float3>::value,
+                "position should be stored in single precision");
+        static_assert(std::is_same<decltype(float3()+float3()),float3>::value,
+                "Vector arithmetic should preserve the element type");
+        static_assert(std::is_same<decltype(float3()*2.0),float3>::value,
+                "Vector arithmetic should preserve the element type");
+        static_assert(std::is_same<decltype(float3()-double3()),double3>::value,
+                "mixed Vector arithmetic should promote to double");
+    	Test_type test;
+    	double3 min(-1,-1,-1);
+    	double3 max(1,1,1);
+    	bool3 periodic(true,true,true);
+    	double diameter = 0.1;
+    	test.init_neighbour_search(min,max,diameter,periodic);
+    	typename Test_type::value_type p;
+
+        get<position>(p) = double3(0,0,0);
+    	test.push_back(p);
+
+        get<position>(p) = double3(diameter/2,0,0);
+    	test.push_back(p);
+
+    	auto tpl = box_search(test.get_query(),double3(1.1*diameter,0,0));
+    	TS_ASSERT_EQUALS(std::distance(tpl.begin(),tpl.end()),1);
+        const double3& dx = tuple_ns::get<1>(*tpl.begin());
+        TS_ASSERT_DELTA(dx[0],-0.6*diameter,1e-7);
+
+    	tpl = box_search(test.get_query(),double3(0.9*diameter,0,0));
+    	TS_ASSERT_EQUALS(std::distance(tpl.begin(),tpl.end()),2);
+
+        // periodic wrap-around is done in double and stored back as float
+        const size_t moved_id = get<id>(test[1]);
+        const double old_x = get<position>(test[1])[0];
+        get<position>(test[1])[0] = old_x + 2.0;
+        test.update_positions();
+        for (size_t i=0; i<test.size(); ++i) {
+            if (get<id>(test[i]) == moved_id) {
+                TS_ASSERT_DELTA(get<position>(test[i])[0],old_x,1e-6);
+            }
+        }
+    }
+
     template <typename Search>
     struct has_n_neighbours {
         unsigned int n;
@@ -264,6 +313,137 @@ For example,
         }
     };
 
+    template <typename Count0, typename Count1>
+    struct count_species_neighbours {
+        template <unsigned int I, typename ReferenceI, 
+                  unsigned int J, typename ReferenceJ, typename double_d>
+        void operator()(std::integral_constant<unsigned int,I>, ReferenceI i,
+                        std::integral_constant<unsigned int,J>, ReferenceJ,
+                        const double_d&) {
+            if (J == 0) {
+                get<Count0>(i)++;
+            } else {
+                get<Count1>(i)++;
+            }
+        }
+    };
+
+    template<template <typename,typename> class VectorType,
+             template <typename> class SearchMethod>
+    void helper_particles_array(void) {
+        ABORIA_VARIABLE(count0,int,"count0")
+        ABORIA_VARIABLE(count1,int,"count1")
+        ABORIA_VARIABLE(scalar,double,"scalar")
+    	typedef Particles<std::tuple<count0,count1>,3,VectorType,SearchMethod> SpeciesA;
+    	typedef Particles<std::tuple<scalar,count0,count1>,3,VectorType,SearchMethod> SpeciesB;
+        typedef position_d<3> position;
+        typedef ParticlesArray<SpeciesA,SpeciesB> Array;
+
+        Array mixture;
+        std::default_random_engine generator;
+        std::uniform_real_distribution<double> uniform(-1,1);
+        for (int i=0; i<200; ++i) {
+            typename SpeciesA::value_type p;
+            get<position>(p) = double3(uniform(generator),uniform(generator),uniform(generator));
+            mixture.template get_species<0>().push_back(p);
+        }
+        for (int i=0; i<100; ++i) {
+            typename SpeciesB::value_type p;
+            get<position>(p) = double3(uniform(generator),uniform(generator),uniform(generator));
+            mixture.template get_species<1>().push_back(p);
+        }
+        TS_ASSERT_EQUALS(mixture.size(),300);
+
+        const double diameter = 0.2;
+        mixture.init_neighbour_search(double3(-1),double3(1),diameter,bool3(true));
+        mixture.for_each_pair(count_species_neighbours<count0,count1>());
+
+        auto brute_force_count = [&](const double3& r, const double3& r2) {
+            double3 dx = r2-r;
+            for (int d=0; d<3; ++d) {
+                if (dx[d] > 1) dx[d] -= 2;
+                if (dx[d] < -1) dx[d] += 2;
+            }
+            return (abs(dx) <= diameter).all() ? 1 : 0;
+        };
+
+        SpeciesA& a = mixture.template get_species<0>();
+        SpeciesB& b = mixture.template get_species<1>();
+        for (size_t i=0; i<a.size(); ++i) {
+            int n0 = 0, n1 = 0;
+            for (size_t j=0; j<a.size(); ++j) {
+                n0 += brute_force_count(get<position>(a[i]),get<position>(a[j]));
+            }
+            for (size_t j=0; j<b.size(); ++j) {
+                n1 += brute_force_count(get<position>(a[i]),get<position>(b[j]));
+            }
+            TS_ASSERT_EQUALS(get<count0>(a[i]),n0);
+            TS_ASSERT_EQUALS(get<count1>(a[i]),n1);
+        }
+        for (size_t i=0; i<b.size(); ++i) {
+            int n0 = 0, n1 = 0;
+            for (size_t j=0; j<a.size(); ++j) {
+                n0 += brute_force_count(get<position>(b[i]),get<position>(a[j]));
+            }
+            for (size_t j=0; j<b.size(); ++j) {
+                n1 += brute_force_count(get<position>(b[i]),get<position>(b[j]));
+            }
+            TS_ASSERT_EQUALS(get<count0>(b[i]),n0);
+            TS_ASSERT_EQUALS(get<count1>(b[i]),n1);
+        }
+    }
+
+    template<template <typename,typename> class VectorType,
+             template <typename> class SearchMethod>
+    void helper_neighbours_csr(void) {
+    	typedef Particles<std::tuple<>,3,VectorType,SearchMethod> Test_type;
+        typedef typename Test_type::position position;
+        Test_type particles;
+        std::default_random_engine generator;
+        std::uniform_real_distribution<double> uniform(-1,1);
+        for (int i=0; i<300; ++i) {
+            typename Test_type::value_type p;
+            get<position>(p) = double3(uniform(generator),uniform(generator),uniform(generator));
+            particles.push_back(p);
+        }
+        const double radius = 0.3;
+        particles.init_neighbour_search(double3(-1),double3(1),radius,bool3(true));
+
+        std::vector<int64_t> indptr,indices;
+        std::vector<double> distances;
+        neighbours_csr(particles,radius,indptr,indices,distances);
+        const size_t n = particles.size();
+        TS_ASSERT_EQUALS(indptr.size(),n+1);
+        TS_ASSERT_EQUALS(indptr[n],indices.size());
+        TS_ASSERT_EQUALS(indptr[n],distances.size());
+
+        // compare against a brute force search over every pair
+        for (size_t i=0; i<n; ++i) {
+            std::vector<std::pair<int64_t,double>> expected;
+            for (size_t j=0; j<n; ++j) {
+                if (i == j) continue;
+                double3 dx = get<position>(particles[j])-get<position>(particles[i]);
+                for (int d=0; d<3; ++d) {
+                    if (dx[d] > 1) dx[d] -= 2;
+                    if (dx[d] < -1) dx[d] += 2;
+                }
+                if (dx.squaredNorm() <= radius*radius) {
+                    expected.push_back(std::make_pair(int64_t(j),dx.norm()));
+                }
+            }
+            std::vector<std::pair<int64_t,double>> found;
+            for (int64_t k=indptr[i]; k<indptr[i+1]; ++k) {
+                found.push_back(std::make_pair(indices[k],distances[k]));
+            }
+            std::sort(found.begin(),found.end());
+            TS_ASSERT_EQUALS(found.size(),expected.size());
+            for (size_t k=0; k<std::min(found.size(),expected.size()); ++k) {
+                TS_ASSERT_EQUALS(found[k].first,expected[k].first);
+                TS_ASSERT_DELTA(found[k].second,expected[k].second,1e-10);
+            }
+        }
+    }
+
     template<unsigned int D, 
              template <typename,typename> class VectorType,
              template <typename> class SearchMethod>
@@ -319,6 +499,9 @@ For example,
     void test_std_vector_bucket_search_serial(void) {
         helper_single_particle<std::vector,bucket_search_serial>();
         helper_two_particles<std::vector,bucket_search_serial>();
+        helper_float_positions<std::vector,bucket_search_serial>();
+        helper_particles_array<std::vector,bucket_search_serial>();
+        helper_neighbours_csr<std::vector,bucket_search_serial>();
         helper_d<1,std::vector,bucket_search_serial>();
         helper_d<2,std::vector,bucket_search_serial>();
         helper_d<3,std::vector,bucket_search_serial>();
@@ -328,6 +511,9 @@ For example,
     void test_std_vector_bucket_search_parallel(void) {
         helper_single_particle<std::vector,bucket_search_parallel>();
         helper_two_particles<std::vector,bucket_search_parallel>();
+        helper_float_positions<std::vector,bucket_search_parallel>();
+        helper_particles_array<std::vector,bucket_search_parallel>();
+        helper_neighbours_csr<std::vector,bucket_search_parallel>();
         helper_d<1,std::vector,bucket_search_parallel>();
         helper_d<2,std::vector,bucket_search_parallel>();
         helper_d<3,std::vector,bucket_search_parallel>();
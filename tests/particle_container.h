@@ -38,6 +38,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PARTICLE_CONTAINER_H_
 
 #include <cxxtest/TestSuite.h>
+#include <sstream>
+#include <fstream>
+#include <map>
 
 #include "Level1.h"
 
@@ -101,6 +104,630 @@ public:
     	TS_ASSERT_EQUALS(test.size(),0);
     }
 
+    template<template <typename,typename> class V, template <typename> class SearchMethod>
+    void helper_find(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        typedef std::tuple<scalar> variables_type;
+    	typedef Particles<variables_type,3,V,SearchMethod> Test_type;
+        typedef typename Test_type::position position;
+    	Test_type test;
+    	test.init_neighbour_search(double3(0),double3(1),0.1,bool3(false));
+    	typename Test_type::value_type p;
+        const size_t n = 100;
+        for (size_t i=0; i<n; ++i) {
+            get<position>(p) = double3(0.99*(n-i)/n,0.5,0.5);
+            get<scalar>(p) = i;
+            test.push_back(p);
+        }
+        for (size_t i=0; i<n; ++i) {
+            auto it = test.find(i);
+            TS_ASSERT(it != test.end());
+            TS_ASSERT_EQUALS(get<id>(*it),i);
+            TS_ASSERT_EQUALS(get<scalar>(*it),i);
+        }
+        TS_ASSERT(test.find(n) == test.end());
+
+        // find() on a const container only reads the lookup table, so it 
+        // can be called from a parallel loop straight after push_back()
+        test.push_back(p);
+        const Test_type& const_test = test;
+        int nfound = 0;
+        #pragma omp parallel for reduction(+:nfound)
+        for (size_t i=0; i<=n; ++i) {
+            auto it = const_test.find(i);
+            if (get<id>(*it) == i) ++nfound;
+        }
+        TS_ASSERT_EQUALS(nfound,n+1);
+        test.erase(test.find(n));
+
+        // a container constructed from a range keeps the ids, and gives 
+        // new particles ids after the largest
+        Test_type range(test.begin()+10,test.begin()+20);
+        size_t max_id = 0;
+        for (size_t i=0; i<range.size(); ++i) {
+            TS_ASSERT(range.find(get<id>(range[i])) == range.begin()+i);
+            max_id = std::max(max_id,size_t(get<id>(range[i])));
+        }
+        range.push_back(p);
+        TS_ASSERT_EQUALS(get<id>(range[range.size()-1]),max_id+1);
+        TS_ASSERT(range.find(max_id+1) == range.begin()+range.size()-1);
+
+        // delete every third particle
+        for (size_t i=0; i<n; i+=3) {
+            get<alive>(*test.find(i)) = false;
+        }
+        test.delete_particles();
+        for (size_t i=0; i<n; ++i) {
+            auto it = test.find(i);
+            if (i%3 == 0) {
+                TS_ASSERT(it == test.end());
+            } else {
+                TS_ASSERT(it != test.end());
+                TS_ASSERT_EQUALS(get<scalar>(*it),i);
+            }
+        }
+
+        // erase single particles
+        test.erase(test.find(1));
+        TS_ASSERT(test.find(1) == test.end());
+        TS_ASSERT_EQUALS(get<scalar>(*test.find(2)),2);
+        TS_ASSERT_EQUALS(get<scalar>(*test.find(n-2)),n-2);
+    }
+
+    template<template <typename,typename> class V, template <typename> class SearchMethod>
+    void helper_swap_variable(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        typedef std::tuple<scalar> variables_type;
+    	typedef Particles<variables_type,3,V,SearchMethod> Test_type;
+        typedef typename Test_type::position position;
+    	Test_type test;
+    	test.init_neighbour_search(double3(0),double3(1),0.1,bool3(false));
+    	typename Test_type::value_type p;
+        const size_t n = 10;
+        for (size_t i=0; i<n; ++i) {
+            get<position>(p) = double3(0.05+0.1*i,0.5,0.5);
+            get<scalar>(p) = i;
+            test.push_back(p);
+        }
+
+        // the neighbour search should see the new values
+        std::vector<double> scalars(n);
+        for (size_t i=0; i<n; ++i) {
+            scalars[i] = 2*get<scalar>(test[i]);
+        }
+        test.template swap_variable<scalar>(scalars);
+        TS_ASSERT_EQUALS(scalars.size(),n);
+        for (size_t i=0; i<n; ++i) {
+            TS_ASSERT_EQUALS(get<scalar>(test[i]),2*scalars[i]);
+            for (const auto& j: box_search(test.get_query(),get<position>(test[i]))) {
+                if (std::get<1>(j).norm() < 0.01) {
+                    TS_ASSERT_EQUALS(get<scalar>(std::get<0>(j)),get<scalar>(test[i]));
+                }
+            }
+        }
+
+        // move all the particles in the y direction
+        std::vector<double3> positions(n);
+        for (size_t i=0; i<n; ++i) {
+            positions[i] = get<position>(test[i]) + double3(0,0.3,0);
+        }
+        test.template swap_variable<position>(positions);
+        test.update_positions();
+        for (size_t i=0; i<n; ++i) {
+            int count = 0;
+            for (const auto& j: box_search(test.get_query(),get<position>(test[i]))) {
+                TS_ASSERT_DELTA(get<position>(std::get<0>(j))[1],0.8,1e-10);
+                if (std::get<1>(j).norm() < 0.01) {
+                    TS_ASSERT_EQUALS(get<id>(std::get<0>(j)),get<id>(test[i]));
+                    ++count;
+                }
+            }
+            TS_ASSERT_EQUALS(count,1);
+        }
+    }
+
+    template<template <typename,typename> class V, template <typename> class SearchMethod>
+    void helper_bulk_insert(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        typedef std::tuple<scalar> variables_type;
+    	typedef Particles<variables_type,3,V,SearchMethod> Test_type;
+        typedef typename Test_type::position position;
+    	Test_type test;
+    	test.init_neighbour_search(double3(0),double3(1),0.1,bool3(false));
+        test.reserve(200);
+
+        // one in ten particles is outside the domain and should be removed
+        const size_t n = 100;
+        std::vector<typename Test_type::value_type> new_particles(n);
+        for (size_t i=0; i<n; ++i) {
+            get<position>(new_particles[i]) = double3(i%10==0?1.5:0.99*i/n,0.5,0.5);
+            get<scalar>(new_particles[i]) = i;
+        }
+        test.insert_bulk(new_particles.begin(),new_particles.end());
+    	TS_ASSERT_EQUALS(test.size(),90);
+        for (size_t i=0; i<test.size(); ++i) {
+            TS_ASSERT(get<alive>(test[i]));
+            TS_ASSERT(test.find(get<id>(test[i])) == test.begin()+i);
+        }
+
+        // resize-then-fill
+        const size_t old_size = test.size();
+        test.resize(old_size+n);
+        for (size_t i=old_size; i<test.size(); ++i) {
+            get<position>(test[i]) = double3(0.5,0.99*(i-old_size)/n,0.5);
+        }
+        test.update_positions();
+    	TS_ASSERT_EQUALS(test.size(),old_size+n);
+        for (size_t i=0; i<test.size(); ++i) {
+            TS_ASSERT(test.find(get<id>(test[i])) == test.begin()+i);
+            if (get<id>(test[i]) < old_size) {
+                TS_ASSERT_EQUALS(get<position>(test[i])[1],0.5);
+            } else {
+                TS_ASSERT_EQUALS(get<position>(test[i])[0],0.5);
+            }
+        }
+
+        // the resized particles are in the neighbour search after 
+        // update_positions()
+        for (size_t i=0; i<test.size(); ++i) {
+            int count = 0;
+            for (const auto& j: box_search(test.get_query(),get<position>(test[i]))) {
+                if (get<id>(std::get<0>(j)) == get<id>(test[i])) ++count;
+            }
+            TS_ASSERT_EQUALS(count,1);
+        }
+
+        // push back a whole container
+        Test_type test2(test);
+        test.push_back(test2);
+    	TS_ASSERT_EQUALS(test.size(),2*test2.size());
+        for (size_t i=0; i<test.size(); ++i) {
+            TS_ASSERT(test.find(get<id>(test[i])) == test.begin()+i);
+        }
+
+        // assignment points the search at the assigned-to particles
+        Test_type test3;
+        test3.push_back(new_particles[1]);
+        const size_t generation = test3.template get_generation<scalar>();
+        test3 = test;
+        TS_ASSERT_LESS_THAN(generation,test3.template get_generation<scalar>());
+    	TS_ASSERT_EQUALS(test3.size(),test.size());
+        for (size_t i=0; i<test.size(); ++i) {
+            get<scalar>(test[i]) = -1;
+        }
+        for (size_t i=0; i<test3.size(); ++i) {
+            TS_ASSERT(test3.find(get<id>(test3[i])) == test3.begin()+i);
+            int count = 0;
+            for (const auto& j: box_search(test3.get_query(),get<position>(test3[i]))) {
+                TS_ASSERT_LESS_THAN_EQUALS(0,get<scalar>(std::get<0>(j)));
+                if (get<id>(std::get<0>(j)) == get<id>(test3[i])) ++count;
+            }
+            TS_ASSERT_EQUALS(count,1);
+        }
+    }
+
+    template<template <typename,typename> class V, template <typename> class SearchMethod>
+    void helper_checkpoint(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        typedef std::tuple<scalar> variables_type;
+    	typedef Particles<variables_type,3,V,SearchMethod> Test_type;
+        typedef typename Test_type::position position;
+    	Test_type test;
+        // large buckets, so that an ordered search has many particles in 
+        // each bucket whose order must be kept
+    	test.init_neighbour_search(double3(0),double3(1),0.5,bool3(true));
+        test.set_seed(42);
+
+        std::default_random_engine generator;
+        std::uniform_real_distribution<double> uniform(0,1);
+    	typename Test_type::value_type p;
+        const size_t n = 100;
+        for (size_t i=0; i<n; ++i) {
+            get<position>(p) = double3(uniform(generator),uniform(generator),uniform(generator));
+            get<scalar>(p) = i;
+            test.push_back(p);
+        }
+        for (size_t i=0; i<n; i+=7) {
+            get<alive>(*test.find(i)) = false;
+        }
+        test.delete_particles();
+        for (size_t i=0; i<test.size(); ++i) {
+            uniform(get<Aboria::random>(test[i]));
+        }
+
+        std::stringstream stream;
+        test.write_checkpoint(stream);
+    	Test_type test2;
+        test2.read_checkpoint(stream);
+
+    	TS_ASSERT_EQUALS(test2.size(),test.size());
+        TS_ASSERT((test2.get_min() == test.get_min()).all());
+        TS_ASSERT((test2.get_max() == test.get_max()).all());
+        TS_ASSERT((test2.get_periodic() == test.get_periodic()).all());
+        TS_ASSERT((test2.get_query().get_min_bucket_size() == 
+                   test.get_query().get_min_bucket_size()).all());
+        for (size_t i=0; i<test.size(); ++i) {
+            TS_ASSERT_EQUALS(get<id>(test2[i]),get<id>(test[i]));
+            TS_ASSERT_EQUALS(get<scalar>(test2[i]),get<scalar>(test[i]));
+            TS_ASSERT((get<position>(test2[i]) == get<position>(test[i])).all());
+            TS_ASSERT(test2.find(get<id>(test[i])) == test2.begin()+i);
+            TS_ASSERT_EQUALS(uniform(get<Aboria::random>(test2[i])),uniform(get<Aboria::random>(test[i])));
+        }
+
+        test.push_back(p);
+        test2.push_back(p);
+        TS_ASSERT_EQUALS(get<id>(test2[test2.size()-1]),get<id>(test[test.size()-1]));
+        TS_ASSERT_EQUALS(uniform(get<Aboria::random>(test2[test2.size()-1])),
+                         uniform(get<Aboria::random>(test[test.size()-1])));
+    }
+
+#ifndef _WIN32
+    void helper_map_checkpoint(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        typedef std::tuple<scalar> variables_type;
+    	typedef Particles<variables_type,3,std::vector> Test_type;
+    	typedef Particles<variables_type,3,mmap_vector> Mapped_type;
+        typedef typename Test_type::position position;
+    	Test_type test;
+    	test.init_neighbour_search(double3(0),double3(1),0.1,bool3(false));
+    	typename Test_type::value_type p;
+        const size_t n = 100;
+        for (size_t i=0; i<n; ++i) {
+            get<position>(p) = double3(0.99*(n-i)/n,0.5,0.5);
+            get<scalar>(p) = i;
+            test.push_back(p);
+        }
+        const std::string filename = "test_map_checkpoint.bin";
+        test.write_checkpoint(filename);
+
+        Mapped_type mapped;
+        mapped.map_checkpoint(filename);
+        TS_ASSERT(get<scalar>(mapped).is_mapped());
+        TS_ASSERT(get<position>(mapped).is_mapped());
+    	TS_ASSERT_EQUALS(mapped.size(),n);
+        for (size_t i=0; i<n; ++i) {
+            TS_ASSERT_EQUALS(get<id>(mapped[i]),get<id>(test[i]));
+            TS_ASSERT_EQUALS(get<scalar>(mapped[i]),get<scalar>(test[i]));
+            TS_ASSERT(mapped.find(get<id>(test[i])) == mapped.begin()+i);
+        }
+
+        // altering a mapped container copies the mapped data
+    	mapped.init_neighbour_search(double3(0),double3(1),0.1,bool3(false));
+        mapped.push_back(p);
+        TS_ASSERT(!get<scalar>(mapped).is_mapped());
+    	TS_ASSERT_EQUALS(mapped.size(),n+1);
+        for (size_t i=0; i<n; ++i) {
+            TS_ASSERT_EQUALS(get<scalar>(mapped[i]),get<scalar>(test[i]));
+        }
+        std::remove(filename.c_str());
+    }
+#endif
+
+    void helper_write_vtu(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(count,int,"count")
+        typedef std::tuple<scalar,count> variables_type;
+    	typedef Particles<variables_type,2> Test_type;
+        typedef typename Test_type::position position;
+    	Test_type test;
+    	typename Test_type::value_type p;
+        const size_t n = 10;
+        for (size_t i=0; i<n; ++i) {
+            get<position>(p) = double2(i,2.0*i);
+            get<scalar>(p) = 0.5*i;
+            get<count>(p) = i;
+            test.push_back(p);
+        }
+        const std::string filename = "test_write_vtu.vtu";
+        write_vtu(test,filename);
+
+        std::ifstream is(filename,std::ios::binary);
+        const std::string file((std::istreambuf_iterator<char>(is)),
+                                std::istreambuf_iterator<char>());
+        const size_t start = file.find("<AppendedData encoding=\"raw\">\n_");
+        TS_ASSERT(start != std::string::npos);
+        const size_t data_start = file.find('_',start) + 1;
+        auto get_array = [&](const std::string& name) {
+            const size_t element = file.find("Name=\""+name+"\"");
+            TS_ASSERT(element != std::string::npos);
+            const size_t offset_start = file.find("offset=\"",element) + 8;
+            const uint64_t offset = std::stoull(file.substr(offset_start,20));
+            return file.data() + data_start + offset;
+        };
+
+        const char* scalar_data = get_array("scalar");
+        TS_ASSERT_EQUALS(*reinterpret_cast<const uint64_t*>(scalar_data),n*sizeof(double));
+        const double* scalars = reinterpret_cast<const double*>(scalar_data + sizeof(uint64_t));
+        const char* count_data = get_array("count");
+        TS_ASSERT_EQUALS(*reinterpret_cast<const uint64_t*>(count_data),n*sizeof(int));
+        const int* counts = reinterpret_cast<const int*>(count_data + sizeof(uint64_t));
+        const char* points_data = get_array("Points");
+        TS_ASSERT_EQUALS(*reinterpret_cast<const uint64_t*>(points_data),3*n*sizeof(double));
+        const double* points = reinterpret_cast<const double*>(points_data + sizeof(uint64_t));
+        for (size_t i=0; i<n; ++i) {
+            TS_ASSERT_EQUALS(scalars[i],get<scalar>(test[i]));
+            TS_ASSERT_EQUALS(counts[i],get<count>(test[i]));
+            TS_ASSERT_EQUALS(points[3*i],get<position>(test[i])[0]);
+            TS_ASSERT_EQUALS(points[3*i+1],get<position>(test[i])[1]);
+            TS_ASSERT_EQUALS(points[3*i+2],0);
+        }
+        std::remove(filename.c_str());
+    }
+
+#ifdef HAVE_VTK
+    void helper_grid_view(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(count,int,"count")
+        ABORIA_VARIABLE(velocity,double3,"velocity")
+        typedef std::tuple<scalar,count,velocity> variables_type;
+    	typedef Particles<variables_type,3> Test_type;
+        typedef typename Test_type::position position;
+    	Test_type test;
+    	typename Test_type::value_type p;
+        const size_t n = 10;
+        for (size_t i=0; i<n; ++i) {
+            get<position>(p) = double3(i,2.0*i,3.0*i);
+            get<scalar>(p) = 0.5*i;
+            get<count>(p) = i;
+            get<velocity>(p) = double3(-1.0*i,-2.0*i,-3.0*i);
+            test.push_back(p);
+        }
+        const Test_type& const_test = test;
+        const size_t scalar_generation = test.get_generation<scalar>();
+
+        vtkSmartPointer<vtkUnstructuredGrid> grid = test.get_grid_view();
+        TS_ASSERT_EQUALS(grid->GetNumberOfPoints(),n);
+        TS_ASSERT_EQUALS(grid->GetNumberOfCells(),n);
+
+        // the arrays refer to the columns rather than copying them
+        vtkPointData* point_data = grid->GetPointData();
+        vtkDataArray* scalars = point_data->GetArray("scalar");
+        vtkDataArray* counts = point_data->GetArray("count");
+        vtkDataArray* velocities = point_data->GetArray("velocity");
+        TS_ASSERT(scalars != NULL);
+        TS_ASSERT(counts != NULL);
+        TS_ASSERT(velocities != NULL);
+        TS_ASSERT_EQUALS(scalars->GetVoidPointer(0),
+                         (const void*)get<scalar>(const_test).data());
+        TS_ASSERT_EQUALS(velocities->GetNumberOfComponents(),3);
+        TS_ASSERT_EQUALS(grid->GetPoints()->GetData()->GetVoidPointer(0),
+                         (const void*)get<position>(const_test).data());
+        for (size_t i=0; i<n; ++i) {
+            TS_ASSERT_EQUALS(scalars->GetTuple1(i),get<scalar>(test[i]));
+            TS_ASSERT_EQUALS(counts->GetTuple1(i),get<count>(test[i]));
+            for (int d=0; d<3; ++d) {
+                TS_ASSERT_EQUALS(velocities->GetComponent(i,d),get<velocity>(test[i])[d]);
+                TS_ASSERT_EQUALS(grid->GetPoint(i)[d],get<position>(test[i])[d]);
+            }
+        }
+
+        // exporting the view does not mark any variable as changed
+        TS_ASSERT_EQUALS(scalar_generation,test.get_generation<scalar>());
+
+        // the vertex cells follow the number of particles
+        test.push_back(p);
+        grid = test.get_grid_view();
+        TS_ASSERT_EQUALS(grid->GetNumberOfPoints(),n+1);
+        TS_ASSERT_EQUALS(grid->GetNumberOfCells(),n+1);
+        TS_ASSERT_EQUALS(grid->GetPointData()->GetArray("scalar")->GetTuple1(n),
+                         get<scalar>(test[n]));
+
+        // positions in other dimensions are copied and padded with zeros
+    	typedef Particles<variables_type,2> Test2_type;
+        typedef typename Test2_type::position position2;
+    	Test2_type test2;
+    	typename Test2_type::value_type p2;
+        for (size_t i=0; i<n; ++i) {
+            get<position2>(p2) = double2(i,2.0*i);
+            test2.push_back(p2);
+        }
+        vtkSmartPointer<vtkUnstructuredGrid> grid2 = test2.get_grid_view();
+        TS_ASSERT_EQUALS(grid2->GetNumberOfPoints(),n);
+        for (size_t i=0; i<n; ++i) {
+            TS_ASSERT_EQUALS(grid2->GetPoint(i)[0],get<position2>(test2[i])[0]);
+            TS_ASSERT_EQUALS(grid2->GetPoint(i)[1],get<position2>(test2[i])[1]);
+            TS_ASSERT_EQUALS(grid2->GetPoint(i)[2],0);
+        }
+    }
+#endif
+
+    void helper_async_writer(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        typedef std::tuple<scalar> variables_type;
+    	typedef Particles<variables_type,3> Test_type;
+    	Test_type test;
+    	typename Test_type::value_type p;
+        const size_t n = 100;
+        for (size_t i=0; i<n; ++i) {
+            get<scalar>(p) = i;
+            test.push_back(p);
+        }
+
+        // the write function runs in the background thread, and only 
+        // records what it was given
+        std::vector<std::string> filenames;
+        std::vector<double> sums;
+        std::vector<size_t> sizes;
+        {
+            async_writer<Test_type> writer(
+                    [&](const Test_type& snapshot, const std::string& filename) {
+                        double sum = 0;
+                        for (size_t i=0; i<snapshot.size(); ++i) {
+                            sum += get<scalar>(snapshot[i]);
+                        }
+                        filenames.push_back(filename);
+                        sums.push_back(sum);
+                        sizes.push_back(snapshot.size());
+                    },1);
+
+            for (int out=0; out<5; ++out) {
+                writer.write(test,"snapshot"+std::to_string(out));
+                // modify the particles straight after queuing a snapshot
+                for (size_t i=0; i<test.size(); ++i) {
+                    get<scalar>(test[i]) += 1;
+                }
+                test.push_back(p);
+            }
+            writer.wait();
+            TS_ASSERT_EQUALS(writer.pending(),0);
+            TS_ASSERT_EQUALS(filenames.size(),5);
+            writer.write(test,"snapshot5");
+        }
+        // the destructor writes any remaining snapshots
+        TS_ASSERT_EQUALS(filenames.size(),6);
+
+        double expected_sum = n*(n-1)/2.0;
+        size_t expected_size = n;
+        for (int out=0; out<6; ++out) {
+            TS_ASSERT_EQUALS(filenames[out],"snapshot"+std::to_string(out));
+            TS_ASSERT_EQUALS(sizes[out],expected_size);
+            TS_ASSERT_DELTA(sums[out],expected_sum,1e-8);
+            expected_sum += expected_size + get<scalar>(p);
+            ++expected_size;
+        }
+    }
+
+    void helper_insert_csv_raw(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(count,int,"count")
+        typedef std::tuple<scalar,count> variables_type;
+    	typedef Particles<variables_type,3> Test_type;
+        typedef typename Test_type::position position;
+        const size_t n = 1000;
+
+        std::stringstream csv;
+        csv << "position_0, position_1, position_2, unused, count, scalar\n";
+        for (size_t i=0; i<n; ++i) {
+            csv << 0.001*i << ", 0.5, 0.25, 7, " << i << ", " << 0.5*i << "\n";
+            if (i == n/2) csv << "\n";
+        }
+        Test_type test;
+    	test.init_neighbour_search(double3(0),double3(1),0.1,bool3(false));
+        test.insert_csv(csv);
+    	TS_ASSERT_EQUALS(test.size(),n);
+        // ids are given in file order, but the search might reorder them
+        for (size_t i=0; i<n; ++i) {
+            auto p = *test.find(i);
+            TS_ASSERT_EQUALS(get<id>(p),i);
+            TS_ASSERT_DELTA(get<position>(p)[0],0.001*i,1e-10);
+            TS_ASSERT_DELTA(get<position>(p)[1],0.5,1e-10);
+            TS_ASSERT_DELTA(get<position>(p)[2],0.25,1e-10);
+            TS_ASSERT_EQUALS(get<count>(p),i);
+            TS_ASSERT_DELTA(get<scalar>(p),0.5*i,1e-10);
+        }
+
+        // small chunk sizes split lines across many chunks, including 
+        // chunks shorter than a line. The last line has no newline
+        for (size_t chunk_size: {7,64,1000}) {
+            std::stringstream chunked_csv(csv.str());
+            chunked_csv.seekp(0,std::ios::end);
+            chunked_csv << 0.999 << ", 0.5, 0.25, 7, " << n << ", " << 0.5*n;
+            Test_type chunked;
+            chunked.insert_csv(chunked_csv,',',chunk_size);
+            TS_ASSERT_EQUALS(chunked.size(),n+1);
+            for (size_t i=0; i<=n; ++i) {
+                TS_ASSERT_EQUALS(get<id>(chunked[i]),i);
+                TS_ASSERT_DELTA(get<position>(chunked[i])[2],0.25,1e-10);
+                TS_ASSERT_EQUALS(get<count>(chunked[i]),i);
+                TS_ASSERT_DELTA(get<scalar>(chunked[i]),0.5*i,1e-10);
+            }
+        }
+
+        // records of (position, scalar), with one record outside the domain
+        std::stringstream raw;
+        for (size_t i=0; i<=n; ++i) {
+            const double record[4] = {0.5, 0.001*i, i==n ? 2.0 : 0.5, 2.0*i};
+            raw.write(reinterpret_cast<const char*>(record),sizeof(record));
+        }
+        test.insert_raw(raw,{"position_0","position_1","position_2","scalar"});
+    	TS_ASSERT_EQUALS(test.size(),2*n);
+        for (size_t i=0; i<n; ++i) {
+            auto p = *test.find(n+i);
+            TS_ASSERT_EQUALS(get<id>(p),n+i);
+            TS_ASSERT_DELTA(get<position>(p)[1],0.001*i,1e-10);
+            TS_ASSERT_EQUALS(get<scalar>(p),2.0*i);
+            TS_ASSERT_EQUALS(get<count>(p),0);
+        }
+    }
+
+    void helper_trajectory(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        typedef std::tuple<scalar> variables_type;
+    	typedef Particles<variables_type,3> Test_type;
+        typedef typename Test_type::position position;
+    	Test_type test;
+    	typename Test_type::value_type p;
+        const size_t n = 100;
+        for (size_t i=0; i<n; ++i) {
+            get<position>(p) = double3(0.01*i,0.5,0.5);
+            get<scalar>(p) = i;
+            test.push_back(p);
+        }
+
+        const double tolerance = 1e-6;
+        const size_t nframes = 25;
+        // the expected (position, scalar) of each particle, by id
+        std::vector<std::map<size_t,std::pair<double3,double>>> expected(nframes);
+        {
+            trajectory_writer<Test_type,scalar> lossy("test_trajectory_lossy.bin",tolerance,10);
+            trajectory_writer<Test_type,scalar> exact("test_trajectory_exact.bin");
+            for (size_t frame=0; frame<nframes; ++frame) {
+                for (size_t i=0; i<test.size(); ++i) {
+                    expected[frame][get<id>(test[i])] = 
+                        std::make_pair(get<position>(test[i]),get<scalar>(test[i]));
+                }
+                lossy.write(test,0.1*frame);
+                exact.write(test,0.1*frame);
+
+                // move the particles, replace one and reverse the order
+                for (size_t i=0; i<test.size(); ++i) {
+                    get<position>(test[i]) += double3(1e-4*std::sin(frame+i),1e-3,0);
+                    get<scalar>(test[i]) *= 0.99;
+                }
+                get<alive>(test[frame]) = false;
+                test.delete_particles();
+                test.push_back(p);
+                for (size_t i=0; i<test.size()/2; ++i) {
+                    typename Test_type::value_type tmp = test[i];
+                    test[i] = test[test.size()-1-i];
+                    test[test.size()-1-i] = tmp;
+                }
+            }
+            TS_ASSERT_EQUALS(lossy.size(),nframes);
+        }
+
+        trajectory_reader lossy("test_trajectory_lossy.bin");
+        trajectory_reader exact("test_trajectory_exact.bin");
+        TS_ASSERT_EQUALS(lossy.size(),nframes);
+        TS_ASSERT_EQUALS(lossy.names()[0],"position");
+        TS_ASSERT_EQUALS(lossy.names()[1],"scalar");
+        const size_t frames[] = {24,3,4,5,17,0,1,12,24};
+        for (size_t frame: frames) {
+            lossy.read(frame);
+            exact.read(frame);
+            TS_ASSERT_DELTA(lossy.time(frame),0.1*frame,1e-10);
+            TS_ASSERT_EQUALS(lossy.ids().size(),expected[frame].size());
+            TS_ASSERT(exact.ids() == lossy.ids());
+            size_t i = 0;
+            for (const auto& e: expected[frame]) {
+                TS_ASSERT_EQUALS(lossy.ids()[i],e.first);
+                for (int d=0; d<3; ++d) {
+                    TS_ASSERT_DELTA(lossy.get("position",i,d),e.second.first[d],0.51*tolerance);
+                    TS_ASSERT_EQUALS(exact.get("position",i,d),e.second.first[d]);
+                }
+                TS_ASSERT_DELTA(lossy.get("scalar",i),e.second.second,0.51*tolerance);
+                TS_ASSERT_EQUALS(exact.get("scalar",i),e.second.second);
+                ++i;
+            }
+        }
+
+        // the deltas should be much smaller than the full values
+        std::ifstream is("test_trajectory_lossy.bin",std::ios::binary|std::ios::ate);
+        TS_ASSERT_LESS_THAN(size_t(is.tellg()),nframes*n*4*sizeof(double)/2);
+        std::remove("test_trajectory_lossy.bin");
+        std::remove("test_trajectory_exact.bin");
+    }
+
     void test_documentation(void) {
         //[particle_container
         /*`
@@ -374,6 +1001,20 @@ public:
         helper_add_particle2<std::vector,bucket_search_serial>();
         helper_add_particle2_dimensions<std::vector,bucket_search_serial>();
         helper_add_delete_particle<std::vector,bucket_search_serial>();
+        helper_find<std::vector,bucket_search_serial>();
+        helper_swap_variable<std::vector,bucket_search_serial>();
+        helper_bulk_insert<std::vector,bucket_search_serial>();
+        helper_checkpoint<std::vector,bucket_search_serial>();
+#ifndef _WIN32
+        helper_map_checkpoint();
+#endif
+        helper_write_vtu();
+#ifdef HAVE_VTK
+        helper_grid_view();
+#endif
+        helper_async_writer();
+        helper_insert_csv_raw();
+        helper_trajectory();
     }
 
     void test_std_vector_bucket_search_parallel(void) {
@@ -381,6 +1022,10 @@ public:
         helper_add_particle2<std::vector,bucket_search_parallel>();
         helper_add_particle2_dimensions<std::vector,bucket_search_parallel>();
         helper_add_delete_particle<std::vector,bucket_search_parallel>();
+        helper_find<std::vector,bucket_search_parallel>();
+        helper_swap_variable<std::vector,bucket_search_parallel>();
+        helper_bulk_insert<std::vector,bucket_search_parallel>();
+        helper_checkpoint<std::vector,bucket_search_parallel>();
     }
 
     void test_thrust_vector(void) {
@@ -341,6 +341,70 @@ public:
     }
 
 
+    // Daxpy for three-dimensional vector variables (a += 0.1*b)
+    double daxpy_vector_aboria_level2(const size_t N, const size_t repeats) {
+        std::cout << "daxpy_vector_aboria_level2: N = "<<N<<std::endl;
+        ABORIA_VARIABLE(a_var,double3,"a")
+        ABORIA_VARIABLE(b_var,double3,"b")
+    	typedef Particles<std::tuple<a_var,b_var>,3> nodes_type;
+       	nodes_type nodes(N);
+        for (int i=0; i<N; i++) {
+            get<a_var>(nodes)[i] = double3(i);
+            get<b_var>(nodes)[i] = double3(i*2);
+        }
+        Symbol<a_var> a;
+        Symbol<b_var> b;
+        Label<0,nodes_type> i(nodes);
+        a[i] += 0.1*b[i];
+        auto t0 = Clock::now();
+        for (int r=0; r<repeats; ++r) {
+            a[i] += 0.1*b[i];
+        }
+        auto t1 = Clock::now();
+        std::chrono::duration<double> dt = t1 - t0;
+        return dt.count()/repeats;
+    }
+
+    double daxpy_vector_aboria_level1(const size_t N, const size_t repeats) {
+        std::cout << "daxpy_vector_aboria_level1: N = "<<N<<std::endl;
+        ABORIA_VARIABLE(a_var,double3,"a")
+        ABORIA_VARIABLE(b_var,double3,"b")
+    	typedef Particles<std::tuple<a_var,b_var>,3> nodes_type;
+       	nodes_type nodes(N);
+        for (int i=0; i<N; i++) {
+            get<a_var>(nodes)[i] = double3(i);
+            get<b_var>(nodes)[i] = double3(i*2);
+        }
+        auto t0 = Clock::now();
+        for (int r=0; r<repeats; ++r) {
+            for (int i=0; i<N; i++) {
+                get<a_var>(nodes)[i] += 0.1*get<b_var>(nodes)[i];
+            }
+        }
+        auto t1 = Clock::now();
+        std::chrono::duration<double> dt = t1 - t0;
+        return dt.count()/repeats;
+    }
+
+    double daxpy_vector_stdvector(const size_t N, const size_t repeats) {
+        std::cout << "daxpy_vector_stdvector: N = "<<N<<std::endl;
+        std::vector<double> a(3*N),b(3*N);
+        for (int i=0; i<3*N; i++) {
+            a[i] = i/3;
+            b[i] = 2*(i/3);
+        }
+        auto t0 = Clock::now();
+        for (int r=0; r<repeats; ++r) {
+            for (int i=0; i<3*N; i++) {
+                a[i] += 0.1*b[i];
+            }
+        }
+        auto t1 = Clock::now();
+        std::chrono::duration<double> dt = t1 - t0;
+        return dt.count()/repeats;
+    }
+
+
     double finite_difference_eigen(const size_t N) {
         std::cout << "finite_difference_eigen: N = "<<N<<std::endl;
 #ifdef HAVE_EIGEN
@@ -1102,6 +1166,29 @@ public:
 
     }
 
+    void test_daxpy_vector() {
+        std::ofstream file;
+        file.open("daxpy_vector.csv");
+        const size_t base_repeats = 1e7;
+        file <<"#"<< std::setw(14) << "N" 
+             << std::setw(15) << "aboria_level1" 
+             << std::setw(15) << "aboria_level2" 
+             << std::setw(15) << "stdvector" << std::endl;
+#ifdef HAVE_OPENMP
+            omp_set_num_threads(1);
+#endif
+        for (int i = 10; i < 8e6; i*=1.2) {
+            const size_t N = i;
+            const size_t repeats = base_repeats/N + 1;
+            file << std::setw(15) << N
+                 << std::setw(15) << N/daxpy_vector_aboria_level1(N,repeats)
+                 << std::setw(15) << N/daxpy_vector_aboria_level2(N,repeats)
+                 << std::setw(15) << N/daxpy_vector_stdvector(N,repeats)
+                 << std::endl;
+        }
+        file.close();
+    }
+
 
 
 
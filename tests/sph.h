@@ -169,11 +169,12 @@ public:
         ABORIA_VARIABLE(velocity_tmp,double3,"temp velocity");
         ABORIA_VARIABLE(varh_omega,double,"varh omega");
         ABORIA_VARIABLE(density,double,"density");
+        ABORIA_VARIABLE(density_sum,double,"density sum");
         ABORIA_VARIABLE(total_force,double3,"total force");
         ABORIA_VARIABLE(is_fixed,uint8_t,"fixed boundary");
         ABORIA_VARIABLE(pressure_div_density2,double,"pressure div density2");
 
-        typedef Particles<std::tuple<kernel_radius,velocity,velocity_tmp,varh_omega,density,total_force,is_fixed,pressure_div_density2>,3,std::vector,SearchMethod> sph_type;
+        typedef Particles<std::tuple<kernel_radius,velocity,velocity_tmp,varh_omega,density,density_sum,total_force,is_fixed,pressure_div_density2>,3,std::vector,SearchMethod> sph_type;
         typedef position_d<3> position;
         sph_type sph;
 
@@ -182,6 +183,7 @@ public:
         Symbol<velocity> v;
         Symbol<velocity_tmp> v0;
         Symbol<density> rho;
+        Symbol<density_sum> drho;
         Symbol<total_force> dvdt;
         Symbol<is_fixed> fixed;
         Symbol<varh_omega> omega;
@@ -231,6 +233,7 @@ public:
                     get<velocity_tmp>(p) = double3(0,0,0);
                     get<varh_omega>(p) = 1.0;
                     get<density>(p) = dens;
+                    get<density_sum>(p) = 0;
                     get<total_force>(p) = double3(0,0,0);
                     get<is_fixed>(p) = get<position>(p)[2]<0;
                     sph.push_back(p);
@@ -263,20 +266,26 @@ public:
                 p[a] += dt/2 * v[a];
 
                 /*
-                 * Calculate omega
+                 * Calculate the sums for omega and the change in density,
+                 * both over the same neighbours
                  */
-                omega[a] = 1.0 - (mass/(rho[a]*NDIM))*sum(b,norm(dx)<2*h[a],pow(norm(dx),2)*F(norm(dx),h[a])+NDIM*W(norm(dx),h[a]));
+                evaluate_sums(b,norm(dx)<2*h[a],
+                    omega[a].assign(pow(norm(dx),2)*F(norm(dx),h[a])+NDIM*W(norm(dx),h[a])),
+                    drho[a].assign(dot(v[b]-v[a],dx*F(norm(dx),h[a])))
+                    );
 
                 /*
                  * 1/2 -> 1 step
                  */
 
                 /* 
-                 * calculate change in density and kernel radius
+                 * calculate omega, change in density and kernel radius
                  */
-                rho[a] += dt*(mass/omega[a]) * sum(b,norm(dx)<2*h[a],
-                        dot(v[b]-v[a],dx*F(norm(dx),h[a])));
-                h[a] = pow(mass/rho[a],1.0/NDIM);
+                evaluate_fused(
+                    omega[a].assign(1.0 - (mass/(rho[a]*NDIM))*omega[a]),
+                    rho[a].plus_assign(dt*(mass/omega[a])*drho[a]),
+                    h[a].assign(pow(mass/rho[a],1.0/NDIM))
+                    );
                 
                 /* 
                  * reset neighbour search for new kernel radius
@@ -288,10 +297,12 @@ public:
                 /* 
                  * advance velocity, position and calculate pdr2
                  */
-                v0[a] = v[a];
-                v[a] += if_else(fixed[a]==false,dt/2 * dvdt[a],0);
-                pdr2[a] = prb*(pow(rho[a]/refd,gamma) - 1.0)/pow(rho[a],2);
-                p[a] += dt/2 * v0[a];
+                evaluate_fused(
+                    v0[a].assign(v[a]),
+                    v[a].plus_assign(if_else(fixed[a]==false,dt/2 * dvdt[a],0)),
+                    pdr2[a].assign(prb*(pow(rho[a]/refd,gamma) - 1.0)/pow(rho[a],2)),
+                    p[a].plus_assign(dt/2 * v0[a])
+                    );
 
 
                 /*
@@ -274,12 +274,589 @@ public:
     	TS_ASSERT_EQUALS(result2,2);
     }
 
+    void helper_particles_view(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+
+    	typedef Particles<std::tuple<scalar>> ParticlesType;
+        typedef ParticlesView<ParticlesType> ViewType;
+        typedef position_d<3> position;
+       	ParticlesType particles;
+
+        double3 min(-1,-1,-1);
+        double3 max(1,1,1);
+        double3 periodic(true,true,true);
+       	double diameter = 0.15;
+        particles.init_neighbour_search(min,max,diameter,periodic);
+
+        const size_t n = 20;
+        for (size_t i=0; i<n; ++i) {
+            particles.push_back(double3(-0.95+0.1*i,0,0));
+        }
+
+        ViewType view(particles,[](ParticlesType::const_reference i) {
+                return get<position>(i)[0] < 0;
+                });
+        TS_ASSERT_EQUALS(view.size(),n/2);
+
+        Symbol<position> p;
+        Symbol<scalar> s;
+        Label<0,ParticlesType> c(particles);
+        Label<0,ViewType> a(view);
+        Label<1,ViewType> b(view);
+        auto dx = create_dx(a,b);
+        Accumulate<std::plus<double> > sum;
+
+        s[c] = 0;
+        s[a] = 1;
+        for (size_t i=0; i<n; ++i) {
+            const bool in_view = get<position>(particles[i])[0] < 0;
+            TS_ASSERT_EQUALS(get<scalar>(particles[i]),in_view?1:0);
+        }
+
+        s[a] = sum(b,true,1);
+        for (size_t i=0; i<n; ++i) {
+            const bool in_view = get<position>(particles[i])[0] < 0;
+            TS_ASSERT_EQUALS(get<scalar>(particles[i]),in_view?n/2:0);
+        }
+
+        // neighbour sum only visits the particles in the view
+        view.init_neighbour_search(diameter);
+        s[a] = sum(b,norm(dx) < diameter,1);
+        for (size_t i=0; i<n; ++i) {
+            const double x = get<position>(particles[i])[0];
+            if (x > 0) {
+                TS_ASSERT_EQUALS(get<scalar>(particles[i]),0);
+            } else if (x < -0.9 || x > -0.1) {
+                TS_ASSERT_EQUALS(get<scalar>(particles[i]),2);
+            } else {
+                TS_ASSERT_EQUALS(get<scalar>(particles[i]),3);
+            }
+        }
+
+        // moving the particles in the view updates the parent container
+        p[a] = p[a] + double3(0,0.1,0);
+        TS_ASSERT_EQUALS(view.size(),n/2);
+        TS_ASSERT_EQUALS(particles.size(),n);
+        for (size_t i=0; i<n; ++i) {
+            const bool in_view = get<position>(particles[i])[0] < 0;
+            TS_ASSERT_DELTA(get<position>(particles[i])[1],in_view?0.1:0,1e-10);
+        }
+        for (size_t i=0; i<view.size(); ++i) {
+            TS_ASSERT_LESS_THAN(get<position>(view[i])[0],0);
+        }
+    }
+
+    void helper_generation(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(other,double,"other")
+
+    	typedef Particles<std::tuple<scalar,other>> ParticlesType;
+        typedef position_d<3> position;
+       	ParticlesType particles;
+        particles.init_neighbour_search(double3(-1),double3(1),0.15,bool3(false));
+        for (size_t i=0; i<10; ++i) {
+            particles.push_back(double3(-0.95+0.1*i,0,0));
+        }
+
+        size_t scalar_generation = particles.get_generation<scalar>();
+        size_t other_generation = particles.get_generation<other>();
+        size_t position_generation = particles.get_generation<position>();
+
+        // a symbolic assignment only changes the assigned variable
+        Symbol<scalar> s;
+        Symbol<position> p;
+        Label<0,ParticlesType> a(particles);
+        s[a] = 1;
+        TS_ASSERT_LESS_THAN(scalar_generation,particles.get_generation<scalar>());
+        TS_ASSERT_EQUALS(other_generation,particles.get_generation<other>());
+        TS_ASSERT_EQUALS(position_generation,particles.get_generation<position>());
+        scalar_generation = particles.get_generation<scalar>();
+
+        // writes through the accessors are only recorded by mark_dirty()
+        get<other>(particles)[0] = 2;
+        TS_ASSERT_EQUALS(other_generation,particles.get_generation<other>());
+        particles.mark_dirty<other>();
+        TS_ASSERT_EQUALS(scalar_generation,particles.get_generation<scalar>());
+        TS_ASSERT_LESS_THAN(other_generation,particles.get_generation<other>());
+        other_generation = particles.get_generation<other>();
+
+        // const access does not
+        const ParticlesType& const_particles = particles;
+        TS_ASSERT_EQUALS(get<other>(const_particles)[0],2);
+        TS_ASSERT_EQUALS(other_generation,particles.get_generation<other>());
+
+        // moving the particles changes the position
+        p[a] = 0.99*p[a];
+        TS_ASSERT_LESS_THAN(position_generation,particles.get_generation<position>());
+        scalar_generation = particles.get_generation<scalar>();
+        other_generation = particles.get_generation<other>();
+
+        // adding a particle changes every variable
+        particles.push_back(double3(0,0,0));
+        TS_ASSERT_LESS_THAN(scalar_generation,particles.get_generation<scalar>());
+        TS_ASSERT_LESS_THAN(other_generation,particles.get_generation<other>());
+    }
+
+    void helper_fused(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(velocity,double3,"velocity")
+
+    	typedef Particles<std::tuple<scalar,velocity>> ParticlesType;
+        typedef position_d<3> position;
+       	ParticlesType particles,sequential;
+        particles.init_neighbour_search(double3(-1),double3(1),0.25,bool3(false));
+        sequential.init_neighbour_search(double3(-1),double3(1),0.25,bool3(false));
+        for (size_t i=0; i<10; ++i) {
+            typename ParticlesType::value_type pi;
+            get<position>(pi) = double3(-0.9+0.17*i,0.01*i,0);
+            get<scalar>(pi) = i;
+            get<velocity>(pi) = double3(0.01,0.02*i,0);
+            particles.push_back(pi);
+            sequential.push_back(pi);
+        }
+
+        Symbol<position> p;
+        Symbol<scalar> s;
+        Symbol<velocity> v;
+        Symbol<id> id_;
+        Accumulate<std::plus<double> > sum;
+
+        Label<0,ParticlesType> a(particles);
+        Label<1,ParticlesType> b(particles);
+        auto dx = create_dx(a,b);
+
+        Label<0,ParticlesType> as(sequential);
+        Label<1,ParticlesType> bs(sequential);
+        auto dxs = create_dx(as,bs);
+
+        // s and p are read by neighbours so are written to buffers, v is
+        // updated in-place and p reads the updated value of v
+        const double dt = 0.1;
+        size_t position_generation = particles.get_generation<position>();
+        evaluate_fused(
+                s[a].assign(sum(b,norm(dx)<0.3,s[b]) + id_[a]),
+                v[a].plus_assign(dt*double3(1,2,3)),
+                p[a].plus_assign(dt*v[a]));
+        TS_ASSERT_LESS_THAN(position_generation,particles.get_generation<position>());
+
+        s[as] = sum(bs,norm(dxs)<0.3,s[bs]) + id_[as];
+        v[as] += dt*double3(1,2,3);
+        p[as] += dt*v[as];
+
+        TS_ASSERT_EQUALS(particles.size(),sequential.size());
+        for (size_t i=0; i<particles.size(); ++i) {
+            auto it = sequential.find(get<id>(particles[i]));
+            TS_ASSERT_EQUALS(get<scalar>(particles[i]),get<scalar>(*it));
+            for (int d=0; d<3; ++d) {
+                TS_ASSERT_EQUALS(get<velocity>(particles[i])[d],get<velocity>(*it)[d]);
+                TS_ASSERT_EQUALS(get<position>(particles[i])[d],get<position>(*it)[d]);
+            }
+        }
+    }
+
+    void helper_scheduled(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(scalar2,double,"scalar2")
+        ABORIA_VARIABLE(count,int,"count")
+        ABORIA_VARIABLE(velocity,double3,"velocity")
+
+    	typedef Particles<std::tuple<scalar,scalar2,count,velocity>> ParticlesType;
+        typedef position_d<3> position;
+       	ParticlesType particles,sequential;
+        particles.init_neighbour_search(double3(-1),double3(1),0.25,bool3(false));
+        sequential.init_neighbour_search(double3(-1),double3(1),0.25,bool3(false));
+        for (size_t i=0; i<10; ++i) {
+            typename ParticlesType::value_type pi;
+            get<position>(pi) = double3(-0.9+0.17*i,0.01*i,0);
+            get<scalar>(pi) = i;
+            get<scalar2>(pi) = 0;
+            get<count>(pi) = 0;
+            get<velocity>(pi) = double3(0.01,0.02*i,0);
+            particles.push_back(pi);
+            sequential.push_back(pi);
+        }
+
+        Symbol<position> p;
+        Symbol<scalar> s;
+        Symbol<scalar2> s2;
+        Symbol<count> c;
+        Symbol<velocity> v;
+        Symbol<id> id_;
+        Accumulate<std::plus<double> > sum;
+        Accumulate<std::plus<int> > sumi;
+
+        Label<0,ParticlesType> a(particles);
+        Label<1,ParticlesType> b(particles);
+        auto dx = create_dx(a,b);
+
+        Label<0,ParticlesType> as(sequential);
+        Label<1,ParticlesType> bs(sequential);
+        auto dxs = create_dx(as,bs);
+
+        // s2 reads the buffered value of s, and c uses the neighbour search
+        // after p is updated, so both need a second pass 
+        const double dt = 0.1;
+        evaluate_scheduled(
+                s[a].assign(sum(b,norm(dx)<0.3,s[b]) + id_[a]),
+                v[a].plus_assign(dt*double3(1,2,3)),
+                s2[a].assign(2*s[a]),
+                p[a].plus_assign(dt*v[a]),
+                c[a].assign(sumi(b,norm(dx)<0.3,1)));
+
+        s[as] = sum(bs,norm(dxs)<0.3,s[bs]) + id_[as];
+        v[as] += dt*double3(1,2,3);
+        s2[as] = 2*s[as];
+        p[as] += dt*v[as];
+        c[as] = sumi(bs,norm(dxs)<0.3,1);
+
+        TS_ASSERT_EQUALS(particles.size(),sequential.size());
+        for (size_t i=0; i<particles.size(); ++i) {
+            auto it = sequential.find(get<id>(particles[i]));
+            TS_ASSERT_EQUALS(get<scalar>(particles[i]),get<scalar>(*it));
+            TS_ASSERT_EQUALS(get<scalar2>(particles[i]),get<scalar2>(*it));
+            TS_ASSERT_EQUALS(get<count>(particles[i]),get<count>(*it));
+            for (int d=0; d<3; ++d) {
+                TS_ASSERT_EQUALS(get<velocity>(particles[i])[d],get<velocity>(*it)[d]);
+                TS_ASSERT_EQUALS(get<position>(particles[i])[d],get<position>(*it)[d]);
+            }
+        }
+
+        // the neighbour sum must see every particle, so the later update 
+        // to alive must not be evaluated before it
+        Symbol<alive> al;
+        evaluate_scheduled(
+                p[a].plus_assign(dt*v[a]),
+                c[a].assign(sumi(b,norm(dx)<0.25,1)),
+                al[a].assign(s[a]<5));
+
+        p[as] += dt*v[as];
+        c[as] = sumi(bs,norm(dxs)<0.25,1);
+        al[as] = s[as]<5;
+
+        TS_ASSERT_EQUALS(particles.size(),sequential.size());
+        for (size_t i=0; i<particles.size(); ++i) {
+            auto it = sequential.find(get<id>(particles[i]));
+            TS_ASSERT_EQUALS(get<scalar>(particles[i]),get<scalar>(*it));
+            TS_ASSERT_EQUALS(get<scalar2>(particles[i]),get<scalar2>(*it));
+            TS_ASSERT_EQUALS(get<count>(particles[i]),get<count>(*it));
+            for (int d=0; d<3; ++d) {
+                TS_ASSERT_EQUALS(get<velocity>(particles[i])[d],get<velocity>(*it)[d]);
+                TS_ASSERT_EQUALS(get<position>(particles[i])[d],get<position>(*it)[d]);
+            }
+        }
+    }
+
+    void helper_neighbour_sums(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(count,double,"count")
+        ABORIA_VARIABLE(force,double3,"force")
+
+    	typedef Particles<std::tuple<scalar,count,force>> ParticlesType;
+        typedef position_d<3> position;
+       	ParticlesType particles,separate;
+        particles.init_neighbour_search(double3(-1),double3(1),0.25,bool3(true));
+        separate.init_neighbour_search(double3(-1),double3(1),0.25,bool3(true));
+        for (size_t i=0; i<20; ++i) {
+            typename ParticlesType::value_type pi;
+            get<position>(pi) = double3(-0.95+0.1*i,0.05*std::sin(i),0);
+            get<scalar>(pi) = i;
+            get<count>(pi) = 1;
+            get<force>(pi) = double3(0,0,0);
+            particles.push_back(pi);
+            separate.push_back(pi);
+        }
+
+        Symbol<scalar> s;
+        Symbol<count> c;
+        Symbol<force> f;
+        Accumulate<std::plus<double> > sum;
+        Accumulate<std::plus<double3> > sum_vect;
+
+        Label<0,ParticlesType> a(particles);
+        Label<1,ParticlesType> b(particles);
+        auto dx = create_dx(a,b);
+
+        Label<0,ParticlesType> as(separate);
+        Label<1,ParticlesType> bs(separate);
+        auto dxs = create_dx(as,bs);
+
+        // s is read through b so is written to a buffer
+        evaluate_sums(b, norm(dx)<0.25,
+                c[a].plus_assign(1),
+                f[a].assign(s[b]*dx),
+                s[a].assign(s[b]/(norm(dx)+1)));
+
+        c[as] += sum(bs,norm(dxs)<0.25,1);
+        f[as] = sum_vect(bs,norm(dxs)<0.25,s[bs]*dxs);
+        s[as] = sum(bs,norm(dxs)<0.25,s[bs]/(norm(dxs)+1));
+
+        for (size_t i=0; i<particles.size(); ++i) {
+            TS_ASSERT_EQUALS(get<count>(particles[i]),get<count>(separate[i]));
+            TS_ASSERT_EQUALS(get<scalar>(particles[i]),get<scalar>(separate[i]));
+            for (int d=0; d<3; ++d) {
+                TS_ASSERT_EQUALS(get<force>(particles[i])[d],get<force>(separate[i])[d]);
+            }
+        }
+
+        // norm(dx) is calculated once for each pair and reused
+        s[as] = sum(bs,norm(dxs)<0.25,norm(dxs)*(1+norm(dxs)));
+        c[as] = sum(bs,norm(dxs)<0.25,sqrt(dot(dxs,dxs))*(1+sqrt(dot(dxs,dxs))));
+        for (size_t i=0; i<separate.size(); ++i) {
+            TS_ASSERT_DELTA(get<scalar>(separate[i]),get<count>(separate[i]),1e-12);
+        }
+    }
+
+    void helper_reduce(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(velocity,double3,"velocity")
+
+    	typedef Particles<std::tuple<scalar,velocity>> ParticlesType;
+       	ParticlesType particles;
+
+        // enough particles to be split over several chunks
+        const size_t n = 5000;
+        double expected_sum = 0;
+        double expected_max = 0;
+        double expected_min = 1000;
+        for (size_t i=0; i<n; ++i) {
+            typename ParticlesType::value_type pi;
+            get<scalar>(pi) = std::sin(i);
+            get<velocity>(pi) = double3(std::cos(i),0.5*i,0);
+            expected_sum += std::sin(i);
+            expected_max = std::max(expected_max,get<velocity>(pi).norm());
+            expected_min = std::min(expected_min,std::sin(i)+2);
+            particles.push_back(pi);
+        }
+
+        Symbol<scalar> s;
+        Symbol<velocity> v;
+        Label<0,ParticlesType> a(particles);
+        Accumulate<std::plus<double> > sum;
+        Accumulate<Aboria::max<double> > max;
+        max.set_init(0);
+        Accumulate<Aboria::min<double> > min;
+        min.set_init(1000);
+
+        TS_ASSERT_EQUALS(reduce(max,a,norm(v[a])),expected_max);
+        TS_ASSERT_EQUALS(reduce(min,a,s[a]+2),expected_min);
+        TS_ASSERT_DELTA(reduce(sum,a,s[a]),expected_sum,1e-10);
+
+        // the result should not depend on the number of threads
+        const double sum_result = reduce(sum,a,s[a]*v[a][0]);
+#ifdef HAVE_OPENMP
+        const int nthreads = omp_get_max_threads();
+        for (int t=1; t<=4; ++t) {
+            omp_set_num_threads(t);
+            TS_ASSERT_EQUALS(reduce(sum,a,s[a]*v[a][0]),sum_result);
+        }
+        omp_set_num_threads(nthreads);
+#endif
+        TS_ASSERT_EQUALS(reduce(sum,a,s[a]*v[a][0]),sum_result);
+    }
+
+    void helper_integrators(void) {
+        ABORIA_VARIABLE(velocity,double3,"velocity")
+        ABORIA_VARIABLE(acceleration,double3,"acceleration")
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(scalar0,double,"scalar0")
+        ABORIA_VARIABLE(scalark,double,"scalark")
+        ABORIA_VARIABLE(scalarksum,double,"scalarksum")
+
+    	typedef Particles<std::tuple<velocity,acceleration,
+                                     scalar,scalar0,scalark,scalarksum>> ParticlesType;
+        typedef position_d<3> position;
+       	ParticlesType leap,verlet,rk2,rk4;
+        const size_t n = 10;
+        std::vector<double3> initial_position(n);
+        std::vector<double3> initial_velocity(n);
+        for (size_t i=0; i<n; ++i) {
+            typename ParticlesType::value_type pi;
+            initial_position[i] = double3(0.1*i,1,0);
+            initial_velocity[i] = double3(0,0,1);
+            get<position>(pi) = initial_position[i];
+            get<velocity>(pi) = initial_velocity[i];
+            get<scalar>(pi) = 0.1*i;
+            leap.push_back(pi);
+            verlet.push_back(pi);
+            rk2.push_back(pi);
+            rk4.push_back(pi);
+        }
+
+        Symbol<position> p;
+        Symbol<velocity> v;
+        Symbol<acceleration> acc;
+        Symbol<scalar> y;
+        Symbol<scalar0> y0;
+        Symbol<scalark> k;
+        Symbol<scalarksum> ksum;
+        Label<0,ParticlesType> a_leap(leap);
+        Label<0,ParticlesType> a_verlet(verlet);
+        Label<0,ParticlesType> a_rk2(rk2);
+        Label<0,ParticlesType> a_rk4(rk4);
+
+        // harmonic oscillator over one period, which should return each
+        // particle to its initial state
+        const double PI = boost::math::constants::pi<double>();
+        const int nsteps = 1000;
+        const double dt = 2*PI/nsteps;
+        acc[a_verlet] = -p[a_verlet];
+        for (int i=0; i<nsteps; ++i) {
+            leapfrog(a_leap,v,dt,-p[a_leap]);
+            velocity_verlet(a_verlet,v,acc,dt,-p[a_verlet]);
+        }
+        for (size_t i=0; i<n; ++i) {
+            for (int d=0; d<3; ++d) {
+                TS_ASSERT_DELTA(get<position>(leap[i])[d],initial_position[i][d],1e-2);
+                TS_ASSERT_DELTA(get<position>(verlet[i])[d],initial_position[i][d],1e-4);
+                TS_ASSERT_DELTA(get<velocity>(verlet[i])[d],initial_velocity[i][d],1e-4);
+            }
+        }
+
+        // exponential decay up to t=1
+        for (int i=0; i<100; ++i) {
+            runge_kutta2(a_rk2,y,y0,0.01,-y[a_rk2]);
+        }
+        for (int i=0; i<10; ++i) {
+            runge_kutta4(a_rk4,y,y0,k,ksum,0.1,-y[a_rk4]);
+        }
+        for (size_t i=0; i<n; ++i) {
+            TS_ASSERT_DELTA(get<scalar>(rk2[i]),0.1*i*std::exp(-1.0),1e-5);
+            TS_ASSERT_DELTA(get<scalar>(rk4[i]),0.1*i*std::exp(-1.0),1e-6);
+        }
+    }
+
+    void helper_random(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(velocity,double3,"velocity")
+
+    	typedef Particles<std::tuple<scalar,velocity>> ParticlesType;
+       	ParticlesType particles(10000);
+
+        Symbol<scalar> s;
+        Symbol<velocity> v;
+        Label<0,ParticlesType> a(particles);
+        Normal N;
+        Uniform U;
+        VectorSymbolic<double,3> vector;
+
+        const size_t n = particles.size();
+        s[a] = U[a];
+        double mean = 0;
+        for (size_t i=0; i<n; ++i) {
+            TS_ASSERT(get<scalar>(particles[i]) >= 0);
+            TS_ASSERT(get<scalar>(particles[i]) < 1);
+            mean += get<scalar>(particles[i]);
+        }
+        TS_ASSERT_DELTA(mean/n,0.5,0.02);
+
+        // normals are drawn in pairs, check that the components are 
+        // uncorrelated
+        v[a] = vector(N[a],N[a],N[a]);
+        double3 vmean(0,0,0);
+        double3 vvar(0,0,0);
+        double cov01 = 0;
+        double cov12 = 0;
+        for (size_t i=0; i<n; ++i) {
+            const double3& vi = get<velocity>(particles[i]);
+            vmean += vi;
+            vvar += vi*vi;
+            cov01 += vi[0]*vi[1];
+            cov12 += vi[1]*vi[2];
+        }
+        for (int d=0; d<3; ++d) {
+            TS_ASSERT_DELTA(vmean[d]/n,0,0.05);
+            TS_ASSERT_DELTA(vvar[d]/n,1,0.05);
+        }
+        TS_ASSERT_DELTA(cov01/n,0,0.05);
+        TS_ASSERT_DELTA(cov12/n,0,0.05);
+    }
+
+    void helper_profile(void) {
+        ABORIA_VARIABLE(scalar,double,"scalar")
+        ABORIA_VARIABLE(count,double,"count")
+
+    	typedef Particles<std::tuple<scalar,count>> ParticlesType;
+        typedef position_d<3> position;
+       	ParticlesType particles;
+        particles.init_neighbour_search(double3(-1),double3(1),0.25,bool3(false));
+        const size_t n = 20;
+        for (size_t i=0; i<n; ++i) {
+            typename ParticlesType::value_type pi;
+            get<position>(pi) = double3(-0.95+0.1*i,0,0);
+            particles.push_back(pi);
+        }
+
+        Symbol<scalar> s;
+        Symbol<count> c;
+        Label<0,ParticlesType> a(particles);
+        Label<1,ParticlesType> b(particles);
+        auto dx = create_dx(a,b);
+        Accumulate<std::plus<double> > sum;
+
+        symbolic_profile().reset();
+        {
+            ProfileTag tag("neighbours");
+            c[a] = sum(b,norm(dx)<0.25,1);
+            c[a] = sum(b,norm(dx)<0.25,1);
+        }
+        s[a] = sum(b,true,1);
+        evaluate_sums(b,norm(dx)<0.25,
+                c[a].assign(1),
+                s[a].assign(norm(dx)));
+        TS_ASSERT_EQUALS(reduce(sum,a,c[a]),94);
+
+#ifdef ABORIA_PROFILE
+        // each particle has itself and up to four others within range
+        const SymbolicProfile::profiles_type& profiles = symbolic_profile().get_profiles();
+        TS_ASSERT_EQUALS(profiles.size(),4);
+
+        const StatementProfile& tagged = profiles.at("neighbours");
+        TS_ASSERT_EQUALS(tagged.calls,2);
+        TS_ASSERT_EQUALS(tagged.accepted,2*94);
+        TS_ASSERT_EQUALS(tagged.evaluations,2*94);
+        TS_ASSERT_LESS_THAN_EQUALS(tagged.accepted,tagged.candidates);
+        TS_ASSERT_LESS_THAN_EQUALS(0,tagged.time);
+
+        const StatementProfile& dense = profiles.at("scalar");
+        TS_ASSERT_EQUALS(dense.calls,1);
+        TS_ASSERT_EQUALS(dense.candidates,n*n);
+        TS_ASSERT_EQUALS(dense.accepted,n*n);
+
+        const StatementProfile& sums = profiles.at("count,scalar");
+        TS_ASSERT_EQUALS(sums.calls,1);
+        TS_ASSERT_EQUALS(sums.accepted,94);
+        TS_ASSERT_EQUALS(sums.evaluations,2*94);
+
+        const StatementProfile& reduction = profiles.at("reduce");
+        TS_ASSERT_EQUALS(reduction.calls,1);
+        TS_ASSERT_EQUALS(reduction.candidates,n);
+        TS_ASSERT_EQUALS(reduction.accepted,n);
+
+        std::ostringstream json,csv;
+        symbolic_profile().write_json(json);
+        symbolic_profile().write_csv(csv);
+        TS_ASSERT_DIFFERS(json.str().find("\"neighbours\": {\"calls\": 2,"),std::string::npos);
+        TS_ASSERT_DIFFERS(csv.str().find("\n\"count,scalar\",1,"),std::string::npos);
+#else
+        TS_ASSERT(symbolic_profile().get_profiles().empty());
+#endif
+    }
+
     void test_default() {
         helper_create_default_vectors();
         helper_create_double_vector();
         helper_transform();
         helper_neighbours();
         helper_level0_expressions();
+        helper_particles_view();
+        helper_generation();
+        helper_fused();
+        helper_scheduled();
+        helper_neighbour_sums();
+        helper_reduce();
+        helper_integrators();
+        helper_random();
+        helper_profile();
     }
 
 };